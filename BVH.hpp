@@ -0,0 +1,109 @@
+#pragma once
+
+//Pieces shared by SceneBVH and TriangleBVH (see those headers):
+// both are binary trees of boxes over runs of items, built by splitting at the median.
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace BVH {
+
+struct Node {
+	glm::vec3 min, max;
+	uint32_t first; //leaf: first item; inner node: first child (the second child is first + 1)
+	uint32_t count; //leaf: number of items; inner node: 0
+};
+
+enum : uint32_t {
+	LeafSize = 4, //most items in a leaf
+	MaxDepth = 64, //(splits are at the median, so depth is about log2(items))
+};
+
+//build 'nodes' over 'items' (reordering them so that each leaf's items are consecutive):
+// nodes[0] is the root; children always come after their parents.
+// 'bounds(item, &min, &max)' gives an item's box and 'center(item)' the point it is sorted by.
+template< typename Item, typename Bounds, typename Center >
+void build(std::vector< Node > &nodes, std::vector< Item > &items, Bounds const &bounds, Center const &center) {
+	nodes.clear();
+	if (items.empty()) return;
+	nodes.reserve(2 * (items.size() / LeafSize + 1));
+	nodes.emplace_back();
+
+	struct Builder {
+		std::vector< Node > &nodes;
+		std::vector< Item > &items;
+		Bounds const &bounds;
+		Center const &center;
+
+		void build_node(uint32_t index, uint32_t begin, uint32_t end) {
+			assert(begin < end);
+
+			//bounds of items, and of their centers:
+			glm::vec3 min, max;
+			bounds(items[begin], min, max);
+			glm::vec3 center_min = center(items[begin]), center_max = center_min;
+			for (uint32_t i = begin + 1; i < end; ++i) {
+				glm::vec3 item_min, item_max;
+				bounds(items[i], item_min, item_max);
+				min = glm::min(min, item_min);
+				max = glm::max(max, item_max);
+				glm::vec3 c = center(items[i]);
+				center_min = glm::min(center_min, c);
+				center_max = glm::max(center_max, c);
+			}
+			nodes[index].min = min;
+			nodes[index].max = max;
+
+			if (end - begin <= LeafSize) {
+				nodes[index].first = begin;
+				nodes[index].count = end - begin;
+				return;
+			}
+
+			//split at the median center along the axis where centers are most spread out:
+			glm::vec3 spread = center_max - center_min;
+			uint32_t axis = 0;
+			if (spread.y > spread[axis]) axis = 1;
+			if (spread.z > spread[axis]) axis = 2;
+			uint32_t mid = begin + (end - begin) / 2;
+			std::nth_element(items.begin() + begin, items.begin() + mid, items.begin() + end, [this, axis](Item const &a, Item const &b) {
+				return center(a)[axis] < center(b)[axis];
+			});
+
+			uint32_t first = uint32_t(nodes.size());
+			nodes.emplace_back();
+			nodes.emplace_back();
+			nodes[index].first = first;
+			nodes[index].count = 0;
+			build_node(first, begin, mid);
+			build_node(first + 1, mid, end);
+		}
+	};
+	Builder builder{nodes, items, bounds, center};
+	builder.build_node(0, 0, uint32_t(items.size()));
+}
+
+//t at which origin + t * direction enters the box [min,max] (0 if it starts inside),
+// or -1 if it misses the box or only reaches it after max_t:
+inline float ray_enters_box(glm::vec3 const &origin, glm::vec3 const &direction, glm::vec3 const &min, glm::vec3 const &max, float max_t) {
+	float t0 = 0.0f, t1 = max_t;
+	for (uint32_t a = 0; a < 3; ++a) {
+		if (direction[a] == 0.0f) {
+			if (origin[a] < min[a] || origin[a] > max[a]) return -1.0f;
+			continue;
+		}
+		float near_t = (min[a] - origin[a]) / direction[a];
+		float far_t = (max[a] - origin[a]) / direction[a];
+		if (near_t > far_t) std::swap(near_t, far_t);
+		t0 = std::max(t0, near_t);
+		t1 = std::min(t1, far_t);
+		if (t0 > t1) return -1.0f;
+	}
+	return t0;
+}
+
+} //namespace BVH
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cassert>
+
+//"DoubleBuffer" passes snapshots (e.g., FramePackets) from update to draw:
+//
+//  //update (end of frame N):
+//  Snapshot &snapshot = buffer.begin_write(); //waits if draw is still reading this slot
+//  ...fill snapshot...
+//  buffer.publish();
+//
+//  //draw (concurrently with update of frame N+1):
+//  Snapshot const *snapshot = buffer.acquire(); //most recently published, or nullptr if none yet
+//  if (snapshot) ...draw it...
+//  buffer.release();
+//
+// Update always writes the slot that isn't the most recently published one, so it only
+// waits when draw is still reading a snapshot published two frames ago.
+// Slots are reused, not reset, so snapshots holding vectors don't allocate once they've grown.
+
+template< typename T >
+struct DoubleBuffer {
+	T &begin_write() {
+		std::unique_lock< std::mutex > lock(mutex);
+		assert(writing == -1U && "Must publish a snapshot before writing another.");
+		writing = (published == 0 ? 1 : 0);
+		released.wait(lock, [this](){ return reading != writing; });
+		return slots[writing];
+	}
+
+	void publish() {
+		std::unique_lock< std::mutex > lock(mutex);
+		assert(writing != -1U && "Must begin_write a snapshot before publishing it.");
+		published = writing;
+		writing = -1U;
+	}
+
+	T const *acquire() {
+		std::unique_lock< std::mutex > lock(mutex);
+		assert(reading == -1U && "Must release a snapshot before acquiring another.");
+		if (published == -1U) return nullptr;
+		reading = published;
+		return &slots[reading];
+	}
+
+	void release() {
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			reading = -1U;
+		}
+		released.notify_all();
+	}
+
+	//------ internals ------
+	T slots[2];
+	std::mutex mutex;
+	std::condition_variable released;
+	uint32_t published = -1U; //index of most recently published slot
+	uint32_t writing = -1U; //index of slot being written (between begin_write and publish)
+	uint32_t reading = -1U; //index of slot being read (between acquire and release)
+};
@@ -0,0 +1,141 @@
+#include "FlatHierarchy.hpp"
+
+#include <cassert>
+#include <utility>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FLAT_HIERARCHY_USE_SSE 1
+#include <xmmintrin.h>
+#endif
+
+void FlatHierarchy::clear() {
+	positions.clear();
+	rotations.clear();
+	scales.clear();
+	parents.clear();
+	local_to_world.clear();
+	transforms.clear();
+}
+
+uint32_t FlatHierarchy::add(uint32_t parent, glm::vec3 const &position, glm::quat const &rotation, glm::vec3 const &scale) {
+	assert((parent == -1U || parent < size()) && "FlatHierarchy entries must be added parents-first.");
+	positions.emplace_back(position);
+	rotations.emplace_back(rotation);
+	scales.emplace_back(scale);
+	parents.emplace_back(parent);
+	local_to_world.emplace_back(1.0f);
+	return size() - 1;
+}
+
+void FlatHierarchy::build(Scene &scene) {
+	clear();
+
+	//depth-first traversal from each root, so parents always end up before children:
+	std::vector< std::pair< Scene::Transform *, uint32_t > > todo;
+	for (Scene::Transform &root : scene.transforms) {
+		if (root.parent) continue;
+		todo.emplace_back(&root, -1U);
+		while (!todo.empty()) {
+			Scene::Transform *t = todo.back().first;
+			uint32_t parent = todo.back().second;
+			todo.pop_back();
+
+			uint32_t index = add(parent, t->position, t->rotation, t->scale);
+			transforms.emplace_back(t);
+
+			for (Scene::Transform *child = t->last_child; child != nullptr; child = child->prev_sibling) {
+				todo.emplace_back(child, index);
+			}
+		}
+	}
+	assert(transforms.size() == scene.transforms.size());
+}
+
+void FlatHierarchy::pull() {
+	assert(transforms.size() == size() && "pull() requires a hierarchy created with build().");
+	for (uint32_t i = 0; i < size(); ++i) {
+		positions[i] = transforms[i]->position;
+		rotations[i] = transforms[i]->rotation;
+		scales[i] = transforms[i]->scale;
+	}
+}
+
+void FlatHierarchy::push() const {
+	assert(transforms.size() == size() && "push() requires a hierarchy created with build().");
+	for (uint32_t i = 0; i < size(); ++i) {
+		Scene::Transform *t = transforms[i];
+		//(values may have been edited here rather than pulled, so the transform gets them too)
+		t->position = positions[i];
+		t->rotation = rotations[i];
+		t->scale = scales[i];
+		t->local_to_world_dirty = false;
+		//only restamp matrices that changed, so that stamp-based caches (RenderQueue's object blocks, SceneBVH's refit) skip the rest:
+		if (t->local_to_world_stamp != 0 && t->local_to_world_cache == local_to_world[i]) continue;
+		t->local_to_world_cache = local_to_world[i];
+		t->world_to_local_dirty = true;
+		t->local_to_world_stamp = Scene::Transform::next_stamp++;
+		if (Scene::Transform::next_stamp == 0) Scene::Transform::next_stamp = 1;
+	}
+}
+
+//The per-entry kernel: builds the upper 3x4 of the local-to-parent matrix (translate * rotate * scale)
+// and multiplies it by the parent's local-to-world matrix (or stores it directly for roots).
+// (this matches Scene::Transform::make_local_to_parent)
+static inline void trs_to_world(glm::vec3 const &p, glm::quat const &q, glm::vec3 const &s, float const *parent, float *out) {
+	//rotation matrix columns (same formula as glm::mat3_cast), scaled:
+	float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+	float local[16] = {
+		s.x * (1.0f - 2.0f * (yy + zz)), s.x * (2.0f * (xy + wz)), s.x * (2.0f * (xz - wy)), 0.0f,
+		s.y * (2.0f * (xy - wz)), s.y * (1.0f - 2.0f * (xx + zz)), s.y * (2.0f * (yz + wx)), 0.0f,
+		s.z * (2.0f * (xz + wy)), s.z * (2.0f * (yz - wx)), s.z * (1.0f - 2.0f * (xx + yy)), 0.0f,
+		p.x, p.y, p.z, 1.0f
+	};
+
+	if (!parent) {
+		for (uint32_t i = 0; i < 16; ++i) out[i] = local[i];
+		return;
+	}
+
+#ifdef FLAT_HIERARCHY_USE_SSE
+	__m128 c0 = _mm_loadu_ps(parent + 0);
+	__m128 c1 = _mm_loadu_ps(parent + 4);
+	__m128 c2 = _mm_loadu_ps(parent + 8);
+	__m128 c3 = _mm_loadu_ps(parent + 12);
+	for (uint32_t c = 0; c < 3; ++c) {
+		__m128 r = _mm_mul_ps(c0, _mm_set1_ps(local[4*c+0]));
+		r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(local[4*c+1])));
+		r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(local[4*c+2])));
+		_mm_storeu_ps(out + 4*c, r);
+	}
+	__m128 r = _mm_mul_ps(c0, _mm_set1_ps(p.x));
+	r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(p.y)));
+	r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(p.z)));
+	r = _mm_add_ps(r, c3);
+	_mm_storeu_ps(out + 12, r);
+#else
+	for (uint32_t c = 0; c < 4; ++c) {
+		for (uint32_t row = 0; row < 4; ++row) {
+			out[4*c+row] =
+				  parent[0+row] * local[4*c+0]
+				+ parent[4+row] * local[4*c+1]
+				+ parent[8+row] * local[4*c+2]
+				+ parent[12+row] * local[4*c+3];
+		}
+	}
+#endif
+}
+
+void FlatHierarchy::update() {
+	assert(local_to_world.size() == size());
+	for (uint32_t i = 0; i < size(); ++i) {
+		float const *parent = nullptr;
+		if (parents[i] != -1U) {
+			assert(parents[i] < i);
+			parent = &local_to_world[parents[i]][0][0];
+		}
+		trs_to_world(positions[i], rotations[i], scales[i], parent, &local_to_world[i][0][0]);
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Scene.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+#include <cstdint>
+
+//"FlatHierarchy" is a flattened, structure-of-arrays copy of a transform hierarchy.
+// Entries are stored in topological order (parents before children), so all world
+// matrices can be computed in a single linear pass over the arrays.
+//
+// It can be used standalone (via 'add') or mirror a Scene's transforms:
+//   FlatHierarchy flat;
+//   flat.build(scene); //once, or whenever the hierarchy's structure changes
+//   ...
+//   flat.pull(); //copy position/rotation/scale from the scene's transforms
+//   flat.update(); //compute all world matrices
+//   flat.push(); //store results (and any edits to positions/rotations/scales) back in the transforms
+
+struct FlatHierarchy {
+	//per-entry data:
+	std::vector< glm::vec3 > positions;
+	std::vector< glm::quat > rotations;
+	std::vector< glm::vec3 > scales;
+	std::vector< uint32_t > parents; //index of parent entry (always less than own index) or -1U for roots
+
+	//computed by update():
+	std::vector< glm::mat4 > local_to_world;
+
+	//(only when built from a scene) the transform each entry mirrors:
+	std::vector< Scene::Transform * > transforms;
+
+	uint32_t size() const { return uint32_t(parents.size()); }
+	void clear();
+
+	//add an entry, returns its index:
+	// (parent must be -1U or the index of an existing entry)
+	uint32_t add(uint32_t parent, glm::vec3 const &position, glm::quat const &rotation, glm::vec3 const &scale);
+
+	//mirror all transforms in a scene:
+	void build(Scene &scene);
+	//copy position/rotation/scale from mirrored transforms:
+	void pull();
+	//compute local_to_world for every entry:
+	void update();
+	//write position/rotation/scale and local_to_world back into mirrored transforms (marking their caches clean):
+	// (only transforms whose local_to_world changed get a new local_to_world_stamp)
+	void push() const;
+};
@@ -0,0 +1,37 @@
+#include "FramePacket.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+void FramePacket::clear() {
+	scenes.clear();
+	objects.clear();
+	object_scenes.clear();
+	local_to_world.clear();
+	local_to_world_stamps.clear();
+}
+
+void FramePacket::add(Scene const &scene) {
+	assert(std::find(scenes.begin(), scenes.end(), &scene) == scenes.end() && "Each scene should only be added once.");
+	uint32_t index = uint32_t(scenes.size());
+	scenes.emplace_back(&scene);
+	for (Scene::Object const &object : scene.objects) {
+		objects.emplace_back(&object);
+		object_scenes.emplace_back(index);
+		local_to_world.emplace_back(object.transform->get_local_to_world());
+		local_to_world_stamps.emplace_back(object.transform->local_to_world_stamp);
+	}
+}
+
+void FramePacket::set_camera(Scene::Camera const *camera) {
+	assert(camera && "Must have a camera to draw from.");
+	world_to_camera = camera->transform->get_world_to_local();
+	fovy = camera->fovy;
+	near = camera->near;
+}
+
+glm::mat4 FramePacket::make_projection(float aspect) const {
+	return glm::infinitePerspective( fovy, aspect, near );
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Scene.hpp"
+#include "DoubleBuffer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+//"FramePacket" is a snapshot of what to draw -- objects, their world matrices, and the camera --
+// so that drawing doesn't need to read the (live, changing) transform hierarchy:
+//
+//  packet.clear();
+//  packet.add(scene); //for each scene
+//  packet.set_camera(camera);
+//  ...
+//  render_queue.draw(packet, aspect, &stats); //later, maybe on another thread
+//
+// Packets copy matrices, but refer to objects (for their program, vao, mesh, material, etc.)
+// by pointer; so while a packet is being drawn, objects must not be created, deleted, or
+// changed other than by moving their transforms.
+// Buffers are kept between clear() calls, so refilling a packet doesn't allocate once it has
+// grown to the size of the scenes.
+
+struct FramePacket {
+	//remove all objects (keeping buffers):
+	void clear();
+
+	//add every object in 'scene' with its current local-to-world matrix (each scene at most once):
+	void add(Scene const &scene);
+
+	//record the camera's position and lens:
+	void set_camera(Scene::Camera const *camera);
+
+	//objects (and the index in 'scenes' each one came from):
+	std::vector< Scene const * > scenes;
+	std::vector< Scene::Object const * > objects;
+	std::vector< uint32_t > object_scenes; //(parallel to objects)
+	std::vector< glm::mat4 > local_to_world; //(parallel to objects)
+	std::vector< uint32_t > local_to_world_stamps; //each transform's local_to_world_stamp (parallel to objects)
+
+	//camera:
+	glm::mat4 world_to_camera = glm::mat4(1.0f);
+	float fovy = glm::radians(60.0f);
+	float near = 0.01f;
+
+	//projection for the camera, given the aspect (x / y) of the framebuffer being drawn to:
+	glm::mat4 make_projection(float aspect) const;
+};
+
+//"FramePackets" passes packets from update to draw, double-buffered (see DoubleBuffer.hpp):
+//
+//  FramePacket &packet = packets.begin_write(); ...fill... packets.publish(); //update
+//  FramePacket const *packet = packets.acquire(); ...draw... packets.release(); //draw
+typedef DoubleBuffer< FramePacket > FramePackets;
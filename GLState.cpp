@@ -0,0 +1,120 @@
+#include "GLState.hpp"
+
+namespace GLState {
+
+Stats stats;
+Stats last_frame;
+
+namespace {
+	//a piece of state, as last set through GLState (or unknown):
+	template< typename T >
+	struct Cached {
+		T value = T();
+		bool known = false;
+	};
+
+	//returns true (and records 'value') if setting 'value' would change 'cached':
+	template< typename T >
+	bool changes(Cached< T > &cached, T const &value) {
+		stats.calls += 1;
+		if (cached.known && cached.value == value) {
+			stats.filtered += 1;
+			return false;
+		}
+		cached.value = value;
+		cached.known = true;
+		return true;
+	}
+
+	struct BlendFunc {
+		GLenum sfactor, dfactor;
+		bool operator==(BlendFunc const &o) const { return sfactor == o.sfactor && dfactor == o.dfactor; }
+	};
+
+	Cached< GLuint > program;
+	Cached< GLuint > vao;
+	Cached< bool > depth_test;
+	Cached< bool > blend;
+	Cached< bool > cull_face;
+	Cached< BlendFunc > blend_func_;
+	Cached< GLenum > blend_equation_;
+	Cached< GLenum > depth_func_;
+	Cached< bool > depth_mask_;
+	Cached< bool > color_mask_;
+
+	Cached< bool > *capability(GLenum cap) {
+		if (cap == GL_DEPTH_TEST) return &depth_test;
+		if (cap == GL_BLEND) return &blend;
+		if (cap == GL_CULL_FACE) return &cull_face;
+		return nullptr;
+	}
+}
+
+void use_program(GLuint program_) {
+	if (changes(program, program_)) glUseProgram(program_);
+}
+
+void bind_vertex_array(GLuint vao_) {
+	if (changes(vao, vao_)) glBindVertexArray(vao_);
+}
+
+void enable(GLenum cap) {
+	Cached< bool > *cached = capability(cap);
+	if (cached) {
+		if (changes(*cached, true)) glEnable(cap);
+	} else {
+		stats.calls += 1;
+		glEnable(cap);
+	}
+}
+
+void disable(GLenum cap) {
+	Cached< bool > *cached = capability(cap);
+	if (cached) {
+		if (changes(*cached, false)) glDisable(cap);
+	} else {
+		stats.calls += 1;
+		glDisable(cap);
+	}
+}
+
+void blend_func(GLenum sfactor, GLenum dfactor) {
+	if (changes(blend_func_, BlendFunc{sfactor, dfactor})) glBlendFunc(sfactor, dfactor);
+}
+
+void blend_equation(GLenum mode) {
+	if (changes(blend_equation_, mode)) glBlendEquation(mode);
+}
+
+void depth_func(GLenum func) {
+	if (changes(depth_func_, func)) glDepthFunc(func);
+}
+
+void depth_mask(bool write) {
+	if (changes(depth_mask_, write)) glDepthMask(write ? GL_TRUE : GL_FALSE);
+}
+
+void color_mask(bool write) {
+	GLboolean mask = (write ? GL_TRUE : GL_FALSE);
+	if (changes(color_mask_, write)) glColorMask(mask, mask, mask, mask);
+}
+
+void invalidate() {
+	program.known = false;
+	vao.known = false;
+	depth_test.known = false;
+	blend.known = false;
+	cull_face.known = false;
+	blend_func_.known = false;
+	blend_equation_.known = false;
+	depth_func_.known = false;
+	depth_mask_.known = false;
+	color_mask_.known = false;
+}
+
+void end_frame() {
+	last_frame = stats;
+	stats = Stats();
+}
+
+} //namespace GLState
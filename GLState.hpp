@@ -0,0 +1,45 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <cstdint>
+
+//GLState remembers the OpenGL state set through it, and skips calls that wouldn't change anything:
+//
+//  GLState::use_program(program); //instead of glUseProgram(program)
+//  GLState::disable(GL_DEPTH_TEST); //instead of glDisable(GL_DEPTH_TEST)
+//
+// State changed by calling OpenGL directly isn't seen, so code that does so
+// should call GLState::invalidate() afterward.
+// (There is one OpenGL context, so there is one cache; only the thread that has
+//  the context current -- see main.cpp -- may use it.)
+
+namespace GLState {
+
+void use_program(GLuint program);
+void bind_vertex_array(GLuint vao);
+
+//GL_DEPTH_TEST, GL_BLEND, and GL_CULL_FACE are cached; other capabilities are passed through:
+void enable(GLenum cap);
+void disable(GLenum cap);
+
+void blend_func(GLenum sfactor, GLenum dfactor);
+void blend_equation(GLenum mode);
+void depth_func(GLenum func);
+void depth_mask(bool write);
+void color_mask(bool write);
+
+//forget all cached state, so the next call of each kind is issued:
+void invalidate();
+
+struct Stats {
+	uint32_t calls = 0; //calls made through GLState
+	uint32_t filtered = 0; //...of which were skipped as redundant
+};
+extern Stats stats; //counts since the last end_frame
+extern Stats last_frame; //counts for the frame most recently ended
+
+//copy stats to last_frame and reset them (called by main.cpp once per frame):
+void end_frame();
+
+} //namespace GLState
@@ -5,18 +5,24 @@
 #include "Sound.hpp"
 #include "MeshBuffer.hpp"
 #include "gl_errors.hpp" //helper for dumpping OpenGL error messages
+#include "GLState.hpp" //skips redundant OpenGL state changes
 #include "read_chunk.hpp" //helper for reading a vector of structures from a file
 #include "data_path.hpp" //helper to get paths relative to executable
 #include "compile_program.hpp" //helper to compile opengl shader programs
 #include "draw_text.hpp" //helper to... um.. draw text
 #include "vertex_color_program.hpp"
+#include "depth_program.hpp"
 #include "WalkMesh.hpp"
+#include "bake_static.hpp"
+#include "TriangleBVH.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
 #include <fstream>
 #include <map>
+#include <unordered_map>
+#include <stdexcept>
 #include <cstddef>
 #include <random>
 #include <algorithm>
@@ -27,13 +33,21 @@ Load< Sound::Sample > sample_bgm(LoadTagDefault, [](){
 });
 
 Load< MeshBuffer > phone_bank_meshes(LoadTagDefault, [](){
-	return new MeshBuffer(data_path("phone-bank.pnc"));
+	return new MeshBuffer(data_path("phone-bank.qpnc"), true, true); //(keeps vertex data for bake_static; welds shared vertices)
 });
 
 Load< GLuint > phone_bank_meshes_for_vertex_color_program(LoadTagDefault, [](){
 	return new GLuint(phone_bank_meshes->make_vao_for_program(vertex_color_program->program));
 });
 
+Load< GLuint > phone_bank_meshes_for_vertex_color_program_instanced(LoadTagDefault, [](){
+	return new GLuint(phone_bank_meshes->make_vao_for_program(vertex_color_program_instanced->program));
+});
+
+Load< GLuint > phone_bank_meshes_for_depth_program(LoadTagDefault, [](){
+	return new GLuint(phone_bank_meshes->make_position_vao());
+});
+
 WalkMesh const *phone_bank_walkmesh = nullptr;
 
 Load< WalkMeshes > phone_bank_walkmeshes(LoadTagDefault, [](){
@@ -43,42 +57,87 @@ Load< WalkMeshes > phone_bank_walkmeshes(LoadTagDefault, [](){
 });
 
 std::vector< Scene::Object * > phone_bank_scene_phones;
+MeshBuffer const *phone_bank_static_meshes = nullptr; //static objects from phone_bank_scene, baked at load
+std::map< std::string, std::vector< glm::vec3 > > phone_bank_occluders; //mesh name -> triangles, for the walls and floors
+std::map< std::string, TriangleBVH > phone_bank_triangles; //mesh name -> triangles, for picking phones (and walls, which block picks)
 
 Load< Scene > phone_bank_scene(LoadTagDefault, [](){
 	Scene *ret = new Scene();
-	ret->load(data_path("phone-bank.scene"), [](Scene &scene, Scene::Transform *transform, std::string const &mesh_name){
+	std::unordered_map< Scene::Transform *, Scene::Object * > transform_objects;
+	ret->load(data_path("phone-bank.scene"), [&](Scene &scene, Scene::Transform *transform, std::string const &mesh_name){
 		Scene::Object *object = scene.new_object(transform);
 		object->program = vertex_color_program->program;
-		object->program_mvp_mat4 = vertex_color_program->object_to_clip_mat4;
-		object->program_mv_mat4x3 = vertex_color_program->object_to_light_mat4x3;
-		object->program_itmv_mat3 = vertex_color_program->normal_to_light_mat3;
+		object->program_object_block = vertex_color_program->object_block_index;
+		object->program_world_to_clip_mat4 = vertex_color_program->world_to_clip_mat4;
+
+		object->instanced_program = vertex_color_program_instanced->program;
+		object->instanced_vao = *phone_bank_meshes_for_vertex_color_program_instanced;
+		object->instanced_program_world_to_clip_mat4 = vertex_color_program_instanced->world_to_clip_mat4;
+		object->instanced_program_instance_data_samplerBuffer = vertex_color_program_instanced->instance_data_samplerBuffer;
+		object->instanced_program_instance_base_int = vertex_color_program_instanced->instance_base_int;
 
 		object->vao = *phone_bank_meshes_for_vertex_color_program;
+		object->depth_vao = *phone_bank_meshes_for_depth_program;
 		MeshBuffer::Mesh const &mesh = phone_bank_meshes->lookup(mesh_name);
-		object->start = mesh.start;
-		object->count = mesh.count;
+		object->index_type = phone_bank_meshes->index_type;
+		object->start = mesh.index_start;
+		object->count = mesh.index_count;
+		object->position_offset = mesh.position_offset;
+		object->position_scale = mesh.position_scale;
+		object->bbox_min = mesh.min;
+		object->bbox_max = mesh.max;
+		object->is_static = true; //(except phones, see below)
+
+		//coarser meshes, if the artist made any, each used at half the size of the previous:
+		std::vector< MeshBuffer::Mesh const * > lods = phone_bank_meshes->lookup_lods(mesh_name);
+		for (uint32_t i = 0; i < lods.size(); ++i) {
+			if (lods[i]->position_offset != mesh.position_offset || lods[i]->position_scale != mesh.position_scale) {
+				throw std::runtime_error("Mesh '" + mesh_name + "' and its LOD " + std::to_string(i + 1) + " are quantized relative to different boxes.");
+			}
+			Scene::Object::LOD lod;
+			lod.start = lods[i]->index_start;
+			lod.count = lods[i]->index_count;
+			lod.screen_size = 0.2f / float(1 << i);
+			object->lods.emplace_back(lod);
+		}
+
+		//the station's shell (walls, floors, and ceilings) hides most of everything else:
+		if (mesh_name == "Circle" || mesh_name == "Circle.001" || mesh_name == "Circle.002" || mesh_name == "Plane") {
+			auto f = phone_bank_occluders.find(mesh_name);
+			if (f == phone_bank_occluders.end()) {
+				f = phone_bank_occluders.emplace(mesh_name, phone_bank_meshes->read_positions(mesh)).first;
+			}
+			object->occluder = &f->second;
+		}
 
-		if (transform->name.substr(0, 5) == "Phone") {
-			phone_bank_scene_phones.emplace_back(object);
+		//phones can be picked, and walls can block picks:
+		if (object->occluder || transform->name.compare(0, 6, "Phone.") == 0) {
+			auto f = phone_bank_triangles.find(mesh_name);
+			if (f == phone_bank_triangles.end()) {
+				f = phone_bank_triangles.emplace(mesh_name, TriangleBVH(phone_bank_meshes->read_positions(mesh))).first;
+			}
+			object->triangles = &f->second;
 		}
+
+		transform_objects.emplace(transform, object);
 	});
 
-	std::cout << "Scene has " << phone_bank_scene_phones.size() << " phones." << std::endl;
+	std::cout << "Scene has " << ret->find_transforms_with_prefix("Phone.").size() << " phones." << std::endl;
 
-	assert(phone_bank_scene_phones.size() == 4);
+	//Gather phones in White, Black, Cyan, Magenta order (that's the sample order):
+	for (char const *name : {"Phone.White", "Phone.Black", "Phone.Cyan", "Phone.Magenta"}) {
+		Scene::Transform *transform = ret->find_transform(name);
+		if (!transform || !transform_objects.count(transform)) {
+			throw std::runtime_error(std::string("phone-bank.scene is missing phone '") + name + "'");
+		}
+		phone_bank_scene_phones.emplace_back(transform_objects[transform]);
+		phone_bank_scene_phones.back()->is_static = false; //(phones are referenced by GameMode, so shouldn't be baked)
+	}
 
-	//sort phones by name so they end up in the same order [Black, Cyan, Magenta, White] regardless of storage order:
-	std::sort(phone_bank_scene_phones.begin(), phone_bank_scene_phones.end(), [](Scene::Object *a,  Scene::Object *b){
-		return a->transform->name < b->transform->name;
-	});
-	//Shuffle phones so they are in White, Black, Cyan, Magenta order (that's the sample order):
-	std::swap(phone_bank_scene_phones[0], phone_bank_scene_phones[3]);
-	std::swap(phone_bank_scene_phones[1], phone_bank_scene_phones[3]);
-	std::swap(phone_bank_scene_phones[2], phone_bank_scene_phones[3]);
-	assert(phone_bank_scene_phones[0]->transform->name == "Phone.White");
-	assert(phone_bank_scene_phones[1]->transform->name == "Phone.Black");
-	assert(phone_bank_scene_phones[2]->transform->name == "Phone.Cyan");
-	assert(phone_bank_scene_phones[3]->transform->name == "Phone.Magenta");
+	//merge everything else into world-space chunks:
+	uint32_t before = uint32_t(ret->objects.size());
+	phone_bank_static_meshes = bake_static(*ret, *phone_bank_meshes, { *phone_bank_meshes_for_vertex_color_program });
+	std::cout << "Baked " << before << " objects into " << ret->objects.size() << "." << std::endl;
 
 	return ret;
 });
@@ -147,8 +206,8 @@ GameMode::GameMode() : mt(uint32_t(std::chrono::system_clock::now().time_since_e
 	{ //Camera is attached to player:
 		Scene::Transform *transform = scene.new_transform();
 		transform->set_parent(player.transform);
-		transform->position = glm::vec3(0.0f, 0.0f, 1.6f); //1.6 units above the groundS
-		transform->rotation = glm::angleAxis(0.5f * 3.14159f, glm::vec3(1.0f, 0.0f, 0.0f)); //rotate -z axis up to point along y axis
+		transform->set_position(glm::vec3(0.0f, 0.0f, 1.6f)); //1.6 units above the groundS
+		transform->set_rotation(glm::angleAxis(0.5f * 3.14159f, glm::vec3(1.0f, 0.0f, 0.0f))); //rotate -z axis up to point along y axis
 		camera = scene.new_camera(transform);
 	}
 
@@ -158,8 +217,10 @@ GameMode::GameMode() : mt(uint32_t(std::chrono::system_clock::now().time_since_e
 		phones.back().object = object;
 	}
 
+	phone_bank_bvh.build(*phone_bank_scene);
+
 	//start background music:
-	bgm_loop = sample_bgm->play(camera->transform->make_local_to_world()[3], 0.0f, Sound::Loop);
+	bgm_loop = sample_bgm->play(camera->transform->get_local_to_world()[3], 0.0f, Sound::Loop);
 	bgm_loop->set_volume(0.5f, 1.0f); //fade in the bgm
 }
 
@@ -189,6 +250,21 @@ bool GameMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size)
 			return true;
 		}
 	}
+	//toggle rendering statistics display:
+	if (evt.type == SDL_KEYDOWN && evt.key.keysym.scancode == SDL_SCANCODE_TAB) {
+		show_stats = !show_stats;
+		return true;
+	}
+	//toggle occlusion culling:
+	if (evt.type == SDL_KEYDOWN && evt.key.keysym.scancode == SDL_SCANCODE_O) {
+		occlusion_culling = !occlusion_culling;
+		return true;
+	}
+	//toggle depth pre-pass:
+	if (evt.type == SDL_KEYDOWN && evt.key.keysym.scancode == SDL_SCANCODE_P) {
+		depth_prepass = !depth_prepass;
+		return true;
+	}
 	//handle tracking the mouse for rotation control:
 	if (!mouse_captured) {
 		if (evt.type == SDL_KEYDOWN && evt.key.keysym.scancode == SDL_SCANCODE_ESCAPE) {
@@ -216,14 +292,17 @@ bool GameMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size)
 			//update camera elevation:
 			const constexpr float PitchLimit = 90.0f / 180.0f * 3.1415926f;
 			player.elevation = glm::clamp(player.elevation + pitch, -PitchLimit, PitchLimit);
-			camera->transform->rotation = glm::angleAxis(player.elevation + 0.5f * 3.1515926f, glm::vec3(1.0f, 0.0f, 0.0f));
+			camera->transform->set_rotation(glm::angleAxis(player.elevation + 0.5f * 3.1515926f, glm::vec3(1.0f, 0.0f, 0.0f)));
 
 			//update player forward direction by rotation around 'up' direction:
 			glm::vec3 up = phone_bank_walkmesh->world_normal(player.walkpoint);
-			player.transform->rotation = glm::normalize(
+			player.transform->set_rotation(glm::normalize(
 				glm::angleAxis(yaw, up)
 				* player.transform->rotation
-			);
+			));
+
+			//(so the phone under the crosshair is current even between frames)
+			update_close_phone();
 
 			return true;
 		}
@@ -235,6 +314,18 @@ bool GameMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size)
 	return false;
 }
 
+void GameMode::update_close_phone() {
+	close_phone = nullptr;
+	glm::mat4 const &camera_to_world = camera->transform->get_local_to_world();
+	glm::vec3 at = glm::vec3(camera_to_world[3]);
+	glm::vec3 forward = -glm::normalize(glm::vec3(camera_to_world[2]));
+	Scene::RaycastHit hit;
+	if (!phone_bank_scene->raycast(at, forward, 2.0f, &hit, &phone_bank_bvh)) return;
+	for (auto &phone : phones) {
+		if (phone.object == hit.object) close_phone = &phone;
+	}
+}
+
 void GameMode::activate_phone() {
 	if (!close_phone) return;
 	if (close_phone->ring_time > 0.0f) {
@@ -356,7 +447,7 @@ void GameMode::update(float elapsed) {
 		phone_bank_walkmesh->walk(player.walkpoint, step);
 
 		//update position from walkmesh:
-		player.transform->position = phone_bank_walkmesh->world_point(player.walkpoint);
+		player.transform->set_position(phone_bank_walkmesh->world_point(player.walkpoint));
 
 		{ //update rotation from walkmesh:
 			glm::vec3 old_up = directions[2];
@@ -375,28 +466,20 @@ void GameMode::update(float elapsed) {
 			glm::vec3 new_forward = glm::cross(new_up, new_right);
 
 			//convert back into quaternion for storage in player transform:
-			player.transform->rotation = glm::normalize(glm::quat_cast(glm::mat3(
+			player.transform->set_rotation(glm::normalize(glm::quat_cast(glm::mat3(
 				new_right,
 				new_forward,
 				new_up
-			)));
+			))));
 		}
 	}
 
-	{ //update which phone is interactable (if any):
-		close_phone = nullptr;
-		glm::vec3 at = glm::vec3(camera->transform->make_local_to_world()[3]);
-		glm::vec3 forward = -glm::vec3(camera->transform->make_local_to_world()[2]);
-		for (auto &phone : phones) {
-			glm::vec3 phone_at = glm::vec3(phone.object->transform->make_local_to_world()[3]);
-			if (glm::length(phone_at - at) < 2.0f && glm::dot(phone_at - at, forward) > 0.2f) {
-				close_phone = &phone;
-			}
-		}
-	}
+	//update which phone is interactable (if any):
+	phone_bank_bvh.refit();
+	update_close_phone();
 
 	{ //set sound positions:
-		glm::mat4 cam_to_world = camera->transform->make_local_to_world();
+		glm::mat4 cam_to_world = camera->transform->get_local_to_world();
 		Sound::lock();
 		Sound::listener.set_position( cam_to_world[3] );
 		bgm_loop->set_position( cam_to_world[3] );
@@ -407,7 +490,7 @@ void GameMode::update(float elapsed) {
 
 	//update phone sounds:
 	for (auto &p : phones) {
-		glm::vec3 at = p.object->transform->make_local_to_world()[3];
+		glm::vec3 at = p.object->transform->get_local_to_world()[3];
 		if (p.ring_time > 0.0f) {
 			if (!p.ring_loop) {
 				p.ring_loop = rings[p.index].basic.play(at, 1.0f, Sound::Loop);
@@ -436,40 +519,83 @@ void GameMode::update(float elapsed) {
 	}
 }
 
+void GameMode::prepare_draw() {
+	DrawState &state = draw_states.begin_write();
+
+	//capture player scene and world:
+	state.packet.clear();
+	state.packet.add(scene);
+	state.packet.add(*phone_bank_scene);
+	state.packet.set_camera(camera);
+
+	//...and the overlay:
+	state.merits = merits;
+	state.demerits = demerits;
+	state.show_stats = show_stats;
+	state.occlusion_culling = occlusion_culling;
+	state.depth_prepass = depth_prepass;
+	state.is_current = (Mode::current.get() == this);
+	state.mouse_captured = mouse_captured;
+	if (close_phone) {
+		state.close_phone_name = close_phone->object->transform->name.substr(6);
+	} else {
+		state.close_phone_name.clear();
+	}
+
+	draw_states.publish();
+}
+
 void GameMode::draw(glm::uvec2 const &drawable_size) {
-	//set up basic OpenGL state:
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
-	glBlendEquation(GL_FUNC_ADD);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	//draw the most recently prepared state (which update, maybe on another thread, won't touch until released):
+	DrawState const *state = draw_states.acquire();
+	if (!state) {
+		draw_states.release();
+		return;
+	}
 
-	//set up light position + color:
-	glUseProgram(vertex_color_program->program);
-	glUniform3fv(vertex_color_program->sun_color_vec3, 1, glm::value_ptr(glm::vec3(0.81f, 0.81f, 0.76f)));
-	glUniform3fv(vertex_color_program->sun_direction_vec3, 1, glm::value_ptr(glm::normalize(glm::vec3(-0.2f, 0.2f, 1.0f))));
-	glUniform3fv(vertex_color_program->sky_color_vec3, 1, glm::value_ptr(glm::vec3(0.4f, 0.4f, 0.45f)));
-	glUniform3fv(vertex_color_program->sky_direction_vec3, 1, glm::value_ptr(glm::vec3(0.0f, 1.0f, 0.0f)));
-	glUseProgram(0);
+	render_queue.measure_overdraw = state->show_stats;
+	render_queue.occlusion_culling = state->occlusion_culling;
+	if (state->depth_prepass) {
+		render_queue.depth_program = depth_program->program;
+		render_queue.depth_program_world_to_clip_mat4 = depth_program->world_to_clip_mat4;
+		render_queue.depth_program_object_to_light_mat4x3 = depth_program->object_to_light_mat4x3;
+	} else {
+		render_queue.depth_program = 0;
+	}
 
-	//fix aspect ratio of camera
-	camera->aspect = drawable_size.x / float(drawable_size.y);
+	//set up basic OpenGL state:
+	GLState::enable(GL_DEPTH_TEST);
+	GLState::enable(GL_BLEND);
+	GLState::blend_equation(GL_FUNC_ADD);
+	GLState::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	//set up light position + color (for both the regular and instanced programs):
+	for (VertexColorProgram const *program : {&*vertex_color_program, &*vertex_color_program_instanced}) {
+		GLState::use_program(program->program);
+		glUniform3fv(program->sun_color_vec3, 1, glm::value_ptr(glm::vec3(0.81f, 0.81f, 0.76f)));
+		glUniform3fv(program->sun_direction_vec3, 1, glm::value_ptr(glm::normalize(glm::vec3(-0.2f, 0.2f, 1.0f))));
+		glUniform3fv(program->sky_color_vec3, 1, glm::value_ptr(glm::vec3(0.4f, 0.4f, 0.45f)));
+		glUniform3fv(program->sky_direction_vec3, 1, glm::value_ptr(glm::vec3(0.0f, 1.0f, 0.0f)));
+	}
+	GLState::use_program(0);
 
-	scene.draw(camera);
+	draw_stats = Scene::DrawStats();
 
-	phone_bank_scene->draw(camera); //will this work?
+	//draw player scene and world together (culled and sorted as one):
+	render_queue.draw(state->packet, drawable_size.x / float(drawable_size.y), &draw_stats);
 
-	glUseProgram(0);
+	GLState::use_program(0);
 
-	glDisable(GL_DEPTH_TEST);
+	GLState::disable(GL_DEPTH_TEST);
 	{ //score messages:
 		std::string message1 = "MERITS: ";
 		for (uint32_t i = 0; i < 10; ++i) {
-			if (i < merits) message1 += '*';
+			if (i < state->merits) message1 += '*';
 			else message1 += '.';
 		}
 		std::string message2 = "DEMERITS: ";
 		for (uint32_t i = 0; i < 3; ++i) {
-			if (i < demerits) message2 += 'X';
+			if (i < state->demerits) message2 += 'X';
 			else message2 += '.';
 		}
 		float height = 0.06f;
@@ -481,11 +607,47 @@ void GameMode::draw(glm::uvec2 const &drawable_size) {
 		draw_text(message2, glm::vec2(-aspect, 1.0f-2.1f*height), height, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
 	}
 
-	if (Mode::current.get() == this) {
-		glDisable(GL_DEPTH_TEST);
+	if (state->show_stats) { //rendering statistics (toggled with TAB):
+		std::vector< std::string > lines;
+		lines.emplace_back("DRAWN " + std::to_string(draw_stats.objects_drawn) + " INSTANCED " + std::to_string(draw_stats.objects_instanced));
+		lines.emplace_back("DRAW CALLS " + std::to_string(draw_stats.draw_calls));
+		lines.emplace_back("TRIANGLES " + std::to_string(draw_stats.triangles_drawn) + " LOD REDUCED " + std::to_string(draw_stats.objects_lod_reduced));
+		lines.emplace_back("OBJECT BLOCKS WRITTEN " + std::to_string(draw_stats.object_blocks_written) + " REUSED " + std::to_string(draw_stats.object_blocks_reused));
+		lines.emplace_back("CULLED " + std::to_string(draw_stats.objects_culled));
+		if (state->occlusion_culling) {
+			lines.emplace_back("OCCLUDED " + std::to_string(draw_stats.objects_occluded) + " TESTS " + std::to_string(draw_stats.occlusion_tests) + " HELD " + std::to_string(draw_stats.occlusion_tests_held));
+			lines.emplace_back("OCCLUDER TRIANGLES " + std::to_string(draw_stats.occluder_triangles));
+		} else {
+			lines.emplace_back("OCCLUSION CULLING OFF");
+		}
+		lines.emplace_back("PROGRAM BINDS " + std::to_string(draw_stats.program_binds) + " SKIPPED " + std::to_string(draw_stats.program_binds_skipped));
+		lines.emplace_back("MATERIAL BINDS " + std::to_string(draw_stats.material_binds) + " SKIPPED " + std::to_string(draw_stats.material_binds_skipped));
+		lines.emplace_back("VAO BINDS " + std::to_string(draw_stats.vao_binds) + " SKIPPED " + std::to_string(draw_stats.vao_binds_skipped));
+		lines.emplace_back("GL STATE CALLS " + std::to_string(GLState::last_frame.calls) + " FILTERED " + std::to_string(GLState::last_frame.filtered));
+		if (state->depth_prepass) {
+			lines.emplace_back("PREPASS DRAW CALLS " + std::to_string(draw_stats.prepass_draw_calls));
+		} else {
+			lines.emplace_back("PREPASS OFF");
+		}
+		{ //average number of times each pixel was shaded (to two decimal places):
+			uint32_t hundredths = uint32_t(100.0f * draw_stats.samples_shaded / float(drawable_size.x * drawable_size.y) + 0.5f);
+			lines.emplace_back("OVERDRAW " + std::to_string(hundredths / 100) + "." + (hundredths % 100 < 10 ? "0" : "") + std::to_string(hundredths % 100));
+		}
+		float height = 0.05f;
+		float aspect = drawable_size.x / float(drawable_size.y);
+		for (uint32_t i = 0; i < lines.size(); ++i) {
+			float width = text_width(lines[i], height);
+			float y = 1.0f - (i + 1) * 1.1f * height;
+			draw_text(lines[i], glm::vec2(aspect - width, y - 0.01f), height, glm::vec4(0.0f, 0.0f, 0.0f, 0.5f));
+			draw_text(lines[i], glm::vec2(aspect - width, y), height, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+		}
+	}
+
+	if (state->is_current) {
+		GLState::disable(GL_DEPTH_TEST);
 		{ //mouse captured message:
 			std::string message;
-			if (mouse_captured) {
+			if (state->mouse_captured) {
 				message = "ESCAPE TO UNGRAB MOUSE * WASD MOVE";
 			} else {
 				message = "CLICK TO GRAB MOUSE * ESCAPE QUIT";
@@ -495,7 +657,7 @@ void GameMode::draw(glm::uvec2 const &drawable_size) {
 			draw_text(message, glm::vec2(-0.5f * width,-0.99f), height, glm::vec4(0.0f, 0.0f, 0.0f, 0.5f));
 			draw_text(message, glm::vec2(-0.5f * width,-1.0f), height, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
 		}
-		if (close_phone) { //phone interaction message:
+		if (!state->close_phone_name.empty()) { //phone interaction message:
 			{
 				std::string message;
 				message = "CLICK FOR";
@@ -507,7 +669,7 @@ void GameMode::draw(glm::uvec2 const &drawable_size) {
 
 			{
 				std::string message;
-				message = close_phone->object->transform->name.substr(6) + " PHONE";
+				message = state->close_phone_name + " PHONE";
 				float height = 0.06f;
 				float width = text_width(message, height);
 				draw_text(message, glm::vec2(-0.5f * width,-height - 0.01f), height, glm::vec4(0.0f, 0.0f, 0.0f, 0.5f));
@@ -516,5 +678,7 @@ void GameMode::draw(glm::uvec2 const &drawable_size) {
 		}
 	}
 
+	draw_states.release();
+
 	GL_ERRORS();
 }
@@ -6,6 +6,9 @@
 #include "WalkMesh.hpp"
 #include "GL.hpp"
 #include "Scene.hpp"
+#include "RenderQueue.hpp"
+#include "DoubleBuffer.hpp"
+#include "SceneBVH.hpp"
 #include "Sound.hpp"
 
 #include <SDL.h>
@@ -13,6 +16,7 @@
 #include <glm/gtc/quaternion.hpp>
 
 #include <vector>
+#include <string>
 #include <deque>
 #include <random>
 
@@ -31,9 +35,16 @@ struct GameMode : public Mode {
 	//draw is called after update:
 	virtual void draw(glm::uvec2 const &drawable_size) override;
 
+	//capture what draw reads into draw_states (so draw can run on main.cpp's render thread):
+	virtual void prepare_draw() override;
+	virtual bool draws_concurrently() const override { return true; }
+
 	//show voice line from phone or bring up calling menu:
 	void activate_phone();
 
+	//set close_phone to the phone the camera is looking at, if it's within reach:
+	void update_close_phone();
+
 	uint32_t merits = 0;
 	uint32_t demerits = 0;
 	void add_merit();
@@ -48,6 +59,11 @@ struct GameMode : public Mode {
 
 	bool mouse_captured = false;
 
+	bool show_stats = false; //show rendering statistics (toggled with TAB)
+	bool occlusion_culling = true; //walls hide most of the station, so skip whatever they cover (toggled with O)
+	bool depth_prepass = false; //(toggled with P)
+	Scene::DrawStats draw_stats; //statistics from the most recent draw (only touched by draw)
+
 	struct {
 		Scene::Transform *transform; //player is at transform's position, looking down y axis with x to the right and z up.
 		WalkMesh::WalkPoint walkpoint;
@@ -80,6 +96,24 @@ struct GameMode : public Mode {
 	Scene scene;
 	Scene::Camera *camera = nullptr;
 
+	RenderQueue render_queue; //draws 'scene' and phone_bank_scene together (only touched by draw)
+
+	//everything draw reads, captured by prepare_draw:
+	struct DrawState {
+		FramePacket packet; //player scene and world
+		uint32_t merits = 0;
+		uint32_t demerits = 0;
+		bool show_stats = false;
+		bool occlusion_culling = true;
+		bool depth_prepass = false;
+		bool is_current = false; //was this Mode::current? (else drawn behind a menu)
+		bool mouse_captured = false;
+		std::string close_phone_name; //empty if no phone is close
+	};
+	DoubleBuffer< DrawState > draw_states;
+
+	SceneBVH phone_bank_bvh; //objects of phone_bank_scene, for finding what the player is looking at
+
 	std::shared_ptr< Sound::PlayingSample > bgm_loop;
 
 	float task_timer = 5.0f;
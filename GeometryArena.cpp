@@ -0,0 +1,202 @@
+#include "GeometryArena.hpp"
+#include "GLState.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+namespace GeometryArena {
+
+std::vector< Block * > blocks;
+
+namespace {
+	bool same_attrib(MeshBuffer::Attrib const &a, MeshBuffer::Attrib const &b) {
+		return a.size == b.size && a.type == b.type && a.normalized == b.normalized && a.stride == b.stride && a.offset == b.offset;
+	}
+
+	bool same_layout(Block const &block, MeshBuffer const &format) {
+		return same_attrib(block.Position, format.Position)
+		    && same_attrib(block.Normal, format.Normal)
+		    && same_attrib(block.Color, format.Color)
+		    && same_attrib(block.TexCoord, format.TexCoord);
+	}
+
+	Block *new_block(MeshBuffer const &format, GLuint vertex_capacity, GLuint index_capacity, bool shared) {
+		Block *block = new Block;
+		block->shared = shared;
+		block->Position = format.Position;
+		block->Normal = format.Normal;
+		block->Color = format.Color;
+		block->TexCoord = format.TexCoord;
+		block->vertex_capacity = vertex_capacity;
+		block->index_capacity = index_capacity;
+		if (vertex_capacity > SharedVertices) block->index_type = GL_UNSIGNED_INT;
+
+		glGenBuffers(1, &block->vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, block->vbo);
+		glBufferData(GL_ARRAY_BUFFER, size_t(vertex_capacity) * format.Position.stride, nullptr, GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		//(the ebo is made by add_ebo when the first indices arrive, since many layouts are never indexed)
+
+		blocks.emplace_back(block);
+		return block;
+	}
+
+	void add_ebo(Block &block) {
+		assert(block.ebo == 0 && block.index_capacity > 0);
+		//(element array bindings belong to the bound vao, so make sure none is bound)
+		GLState::bind_vertex_array(0);
+		glGenBuffers(1, &block.ebo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block.ebo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, size_t(block.index_capacity) * (block.index_type == GL_UNSIGNED_SHORT ? 2 : 4), nullptr, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		//vaos already made for this block need the new ebo too:
+		auto bind_ebo = [&](GLuint vao) {
+			GLState::bind_vertex_array(vao);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block.ebo); //(stays bound to the vao)
+		};
+		for (auto const &program_vao : block.program_vaos) bind_ebo(program_vao.second);
+		if (block.position_vao) bind_ebo(block.position_vao);
+		GLState::bind_vertex_array(0);
+	}
+}
+
+Range allocate(MeshBuffer const &format, uint8_t const *vertex_data, size_t vertex_bytes, std::vector< uint32_t > const &indices) {
+	GLsizei stride = format.Position.stride;
+	if (stride <= 0 || vertex_bytes % stride != 0) {
+		throw std::runtime_error("GeometryArena given vertex data that isn't a whole number of vertices.");
+	}
+	GLuint vertex_count = GLuint(vertex_bytes / stride);
+	GLuint index_count = GLuint(indices.size());
+
+	//first shared block with the same layout and enough room, or a new one:
+	Block *block = nullptr;
+	for (Block *b : blocks) {
+		if (b->shared && same_layout(*b, format)
+		 && b->vertex_count + vertex_count <= b->vertex_capacity
+		 && b->index_count + index_count <= b->index_capacity) {
+			block = b;
+			break;
+		}
+	}
+	if (!block) {
+		if (vertex_count <= SharedVertices && index_count <= SharedIndices) {
+			block = new_block(format, SharedVertices, SharedIndices, true);
+		} else {
+			block = new_block(format, vertex_count, index_count, false); //(too big to share)
+		}
+	}
+
+	Range range;
+	range.block = block;
+	range.vertex_base = block->vertex_count;
+	range.index_base = block->index_count;
+
+	if (vertex_count > 0) {
+		glBindBuffer(GL_ARRAY_BUFFER, block->vbo);
+		glBufferSubData(GL_ARRAY_BUFFER, size_t(range.vertex_base) * stride, vertex_bytes, vertex_data);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		block->vertex_count += vertex_count;
+	}
+
+	if (index_count > 0) {
+		if (!block->ebo) add_ebo(*block);
+		GLState::bind_vertex_array(0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block->ebo);
+		//indices are stored relative to the block:
+		if (block->index_type == GL_UNSIGNED_SHORT) {
+			std::vector< uint16_t > shorts(index_count);
+			for (GLuint i = 0; i < index_count; ++i) {
+				assert(indices[i] < vertex_count);
+				shorts[i] = uint16_t(range.vertex_base + indices[i]);
+			}
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, size_t(range.index_base) * sizeof(uint16_t), shorts.size() * sizeof(uint16_t), shorts.data());
+		} else {
+			std::vector< uint32_t > ints(index_count);
+			for (GLuint i = 0; i < index_count; ++i) {
+				assert(indices[i] < vertex_count);
+				ints[i] = range.vertex_base + indices[i];
+			}
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, size_t(range.index_base) * sizeof(uint32_t), ints.size() * sizeof(uint32_t), ints.data());
+		}
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		block->index_count += index_count;
+	}
+
+	return range;
+}
+
+GLuint vao_for_program(Block &block, GLuint program) {
+	auto f = block.program_vaos.find(program);
+	if (f != block.program_vaos.end()) return f->second;
+
+	//create a new vertex array object:
+	GLuint vao = 0;
+	glGenVertexArrays(1, &vao);
+	GLState::bind_vertex_array(vao);
+	if (block.ebo) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block.ebo); //(stays bound to the vao)
+
+	//Try to bind all attributes in this block:
+	std::set< GLuint > bound;
+	glBindBuffer(GL_ARRAY_BUFFER, block.vbo);
+	auto bind_attribute = [&](char const *name, MeshBuffer::Attrib const &attrib) {
+		if (attrib.size == 0) return; //don't bind empty attribs
+		GLint location = glGetAttribLocation(program, name);
+		if (location == -1) {
+			std::cerr << "WARNING: attribute '" << name << "' in mesh buffer isn't active in program." << std::endl;
+		} else {
+			glVertexAttribPointer(location, attrib.size, attrib.type, attrib.normalized, attrib.stride, (GLbyte *)0 + attrib.offset);
+			glEnableVertexAttribArray(location);
+			bound.insert(location);
+		}
+	};
+	bind_attribute("Position", block.Position);
+	bind_attribute("Normal", block.Normal);
+	bind_attribute("Color", block.Color);
+	bind_attribute("TexCoord", block.TexCoord);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::bind_vertex_array(0);
+
+	//Check that all active attributes were bound:
+	GLint active = 0;
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &active);
+	assert(active >= 0 && "Doesn't makes sense to have negative active attributes.");
+	for (GLuint i = 0; i < GLuint(active); ++i) {
+		GLchar name[100];
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveAttrib(program, i, 100, NULL, &size, &type, name);
+		name[99] = '\0';
+		GLint location = glGetAttribLocation(program, name);
+		if (!bound.count(GLuint(location))) {
+			throw std::runtime_error("ERROR: active attribute '" + std::string(name) + "' in program is not bound.");
+		}
+	}
+
+	block.program_vaos.insert(std::make_pair(program, vao));
+	return vao;
+}
+
+GLuint position_vao(Block &block) {
+	if (block.position_vao != 0) return block.position_vao;
+	if (block.Position.size == 0) {
+		throw std::runtime_error("ERROR: can't make a position vao for a mesh buffer without positions.");
+	}
+	GLuint vao = 0;
+	glGenVertexArrays(1, &vao);
+	GLState::bind_vertex_array(vao);
+	if (block.ebo) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block.ebo); //(stays bound to the vao)
+	glBindBuffer(GL_ARRAY_BUFFER, block.vbo);
+	glVertexAttribPointer(0, block.Position.size, block.Position.type, block.Position.normalized, block.Position.stride, (GLbyte *)0 + block.Position.offset);
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::bind_vertex_array(0);
+	block.position_vao = vao;
+	return vao;
+}
+
+} //namespace GeometryArena
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "MeshBuffer.hpp"
+#include "GL.hpp"
+
+#include <map>
+#include <vector>
+#include <cstdint>
+
+//GeometryArena holds the vertices and indices of every MeshBuffer, packed into a few large
+// buffers ("blocks") per vertex layout, so that meshes from different MeshBuffers share vbos and vaos:
+//
+//  GeometryArena::Range range = GeometryArena::allocate(format, vertex_data, vertex_bytes, indices);
+//  //vertices are now in range.block->vbo from range.vertex_base, indices in range.block->ebo from range.index_base
+//  GLuint vao = GeometryArena::vao_for_program(*range.block, program); //(the same for every range in the block)
+//
+// Blocks hold at most 65536 vertices, so the indices in them (which are offset to be relative to the
+// block, not the range) fit in 16 bits; data too big for a shared block gets a block of its own.
+// Space is never freed (MeshBuffers are loaded once and kept).
+// allocate, vao_for_program, and position_vao make GL calls, so only call them on the GL thread (see GLState.hpp).
+
+namespace GeometryArena {
+
+struct Block {
+	GLuint vbo = 0;
+	GLuint ebo = 0; //(0 until the first indices are allocated in the block)
+	GLenum index_type = GL_UNSIGNED_SHORT; //(GL_UNSIGNED_INT only for blocks of more than 65536 vertices)
+
+	//vertex layout (as in MeshBuffer; stride is part of each attrib):
+	MeshBuffer::Attrib Position;
+	MeshBuffer::Attrib Normal;
+	MeshBuffer::Attrib Color;
+	MeshBuffer::Attrib TexCoord;
+
+	bool shared = true; //(false for blocks made to hold a single range that was too big to share)
+	GLuint vertex_capacity = 0, vertex_count = 0;
+	GLuint index_capacity = 0, index_count = 0;
+
+	//vaos made by vao_for_program and position_vao:
+	std::map< GLuint, GLuint > program_vaos;
+	GLuint position_vao = 0;
+};
+
+struct Range {
+	Block *block = nullptr;
+	GLuint vertex_base = 0; //first vertex in block->vbo
+	GLuint index_base = 0; //first index in block->ebo
+};
+
+//copy vertex data laid out as in 'format' (and indices into that data, if any) to a block with the same layout:
+Range allocate(MeshBuffer const &format, uint8_t const *vertex_data, size_t vertex_bytes, std::vector< uint32_t > const &indices);
+
+//build (on first use) a vertex array object that links a block's buffers to attributes of a program:
+//  will throw if program defines attributes not contained in the block
+//  and warn if the block contains attributes not active in the program
+GLuint vao_for_program(Block &block, GLuint program);
+
+//build (on first use) a vertex array object with only the Position attribute (bound to location 0):
+GLuint position_vao(Block &block);
+
+//shared blocks hold up to this many vertices and indices:
+constexpr GLuint SharedVertices = 65536;
+constexpr GLuint SharedIndices = 6 * 65536; //(about two triangles per vertex)
+
+extern std::vector< Block * > blocks; //every block, in order of creation
+
+} //namespace GeometryArena
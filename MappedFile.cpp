@@ -0,0 +1,78 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(std::string const &filename) {
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open '" + filename + "'.");
+	}
+	file_handle = file;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size)) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to get the size of '" + filename + "'.");
+	}
+	size = size_t(file_size.QuadPart);
+	if (size == 0) return; //(empty files can't be mapped)
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	void *view = (mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr);
+	if (!view) {
+		if (mapping) CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error("Failed to map '" + filename + "'.");
+	}
+	mapping_handle = mapping;
+	data = reinterpret_cast< uint8_t const * >(view);
+}
+
+MappedFile::~MappedFile() {
+	if (data) UnmapViewOfFile(data);
+	if (mapping_handle) CloseHandle(mapping_handle);
+	if (file_handle) CloseHandle(file_handle);
+}
+
+#else
+
+MappedFile::MappedFile(std::string const &filename) {
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		throw std::runtime_error("Failed to open '" + filename + "'.");
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		throw std::runtime_error("Failed to get the size of '" + filename + "'.");
+	}
+	size = size_t(info.st_size);
+	if (size == 0) { //(empty files can't be mapped)
+		close(fd);
+		return;
+	}
+
+	void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); //(the mapping keeps the file open)
+	if (mapped == MAP_FAILED) {
+		throw std::runtime_error("Failed to map '" + filename + "'.");
+	}
+	madvise(mapped, size, MADV_SEQUENTIAL); //(only a hint, so failure doesn't matter)
+	data = reinterpret_cast< uint8_t const * >(mapped);
+}
+
+MappedFile::~MappedFile() {
+	if (data) munmap(const_cast< uint8_t * >(data), size);
+}
+
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+//MappedFile maps a whole file (read-only) into memory, so it can be read without copying:
+//
+//  MappedFile file(data_path("meshes.pnc"));
+//  uint8_t const *at = file.data; //file.size bytes, valid while 'file' exists
+//
+// (see the in-memory read_chunk overloads in read_chunk.hpp)
+
+struct MappedFile {
+	//note: will throw if the file can't be opened or mapped.
+	MappedFile(std::string const &filename);
+	~MappedFile();
+
+	MappedFile(MappedFile const &) = delete;
+	MappedFile &operator=(MappedFile const &) = delete;
+
+	uint8_t const *data = nullptr; //(nullptr if the file is empty)
+	size_t size = 0;
+
+	//internals:
+	#if defined(_WIN32)
+	void *file_handle = nullptr; //(HANDLEs, to avoid including windows.h here)
+	void *mapping_handle = nullptr;
+	#endif
+};
@@ -0,0 +1,72 @@
+#include "Material.hpp"
+
+#include <stdexcept>
+
+Material::Uniform &Material::find_or_add(std::string const &name, Uniform::Type type) {
+	for (auto &uniform : uniforms) {
+		if (uniform.name == name) {
+			if (uniform.type != type) {
+				throw std::runtime_error("Material uniform '" + name + "' set with a different type than before.");
+			}
+			return uniform;
+		}
+	}
+	uniforms.emplace_back();
+	uniforms.back().name = name;
+	uniforms.back().type = type;
+	locations.clear(); //(cached location lists no longer match 'uniforms')
+	return uniforms.back();
+}
+
+void Material::set(std::string const &name, float value) {
+	find_or_add(name, Uniform::Float).value = glm::vec4(value, 0.0f, 0.0f, 0.0f);
+}
+
+void Material::set(std::string const &name, glm::vec2 const &value) {
+	find_or_add(name, Uniform::Vec2).value = glm::vec4(value.x, value.y, 0.0f, 0.0f);
+}
+
+void Material::set(std::string const &name, glm::vec3 const &value) {
+	find_or_add(name, Uniform::Vec3).value = glm::vec4(value, 0.0f);
+}
+
+void Material::set(std::string const &name, glm::vec4 const &value) {
+	find_or_add(name, Uniform::Vec4).value = value;
+}
+
+void Material::set(std::string const &name, int32_t value) {
+	find_or_add(name, Uniform::Int).int_value = value;
+}
+
+void Material::apply_uniforms(GLuint program) const {
+	if (uniforms.empty()) return;
+
+	//find (or look up) locations for this program:
+	std::vector< GLint > const *program_locations = nullptr;
+	for (auto const &entry : locations) {
+		if (entry.first == program) {
+			program_locations = &entry.second;
+			break;
+		}
+	}
+	if (!program_locations) {
+		locations.emplace_back(program, std::vector< GLint >());
+		std::vector< GLint > &list = locations.back().second;
+		list.reserve(uniforms.size());
+		for (auto const &uniform : uniforms) {
+			list.emplace_back(glGetUniformLocation(program, uniform.name.c_str()));
+		}
+		program_locations = &list;
+	}
+
+	for (uint32_t i = 0; i < uniforms.size(); ++i) {
+		GLint location = (*program_locations)[i];
+		if (location == -1) continue;
+		Uniform const &uniform = uniforms[i];
+		if      (uniform.type == Uniform::Float) glUniform1f(location, uniform.value.x);
+		else if (uniform.type == Uniform::Vec2)  glUniform2f(location, uniform.value.x, uniform.value.y);
+		else if (uniform.type == Uniform::Vec3)  glUniform3f(location, uniform.value.x, uniform.value.y, uniform.value.z);
+		else if (uniform.type == Uniform::Vec4)  glUniform4f(location, uniform.value.x, uniform.value.y, uniform.value.z, uniform.value.w);
+		else if (uniform.type == Uniform::Int)   glUniform1i(location, uniform.int_value);
+	}
+}
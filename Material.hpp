@@ -0,0 +1,56 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+//"Material" holds the surface settings shared by many objects -- uniform values and render state:
+//
+//  Material *brass = new Material();
+//  brass->set("glossiness", 0.8f);
+//  brass->set("tint", glm::vec3(1.0f, 0.8f, 0.4f));
+//  object->material = brass; //for each brass object
+//
+// RenderQueue sorts objects by material (within each program), and only uploads uniforms
+// when the program or material changes, rather than once per object.
+//
+// Uniforms are set by name; their locations are looked up the first time the material is
+// used with each program (uniforms a program doesn't have are skipped), so a material works
+// with both an object's program and its instanced_program.
+
+struct Material {
+	//------ uniform values ------
+	struct Uniform {
+		std::string name;
+		enum Type : uint8_t { Float, Vec2, Vec3, Vec4, Int } type = Float;
+		glm::vec4 value = glm::vec4(0.0f); //(Float through Vec4 use the first 1-4 components)
+		int32_t int_value = 0; //(Int, e.g., the texture unit for a sampler)
+	};
+	std::vector< Uniform > uniforms;
+
+	//set a uniform's value (adding it if this material doesn't have it yet):
+	void set(std::string const &name, float value);
+	void set(std::string const &name, glm::vec2 const &value);
+	void set(std::string const &name, glm::vec3 const &value);
+	void set(std::string const &name, glm::vec4 const &value);
+	void set(std::string const &name, int32_t value);
+
+	//------ render state ------
+	//(RenderQueue sets these per material, and restores the defaults after drawing)
+	bool depth_write = true; //glDepthMask (objects that don't write depth are left out of the depth pre-pass)
+	bool cull_back_faces = false; //GL_CULL_FACE
+
+	//upload uniform values to 'program', which must be the current program:
+	void apply_uniforms(GLuint program) const;
+
+	//------ internals ------
+
+	//uniform locations, looked up per program (each list is parallel to 'uniforms'):
+	mutable std::vector< std::pair< GLuint, std::vector< GLint > > > locations;
+
+	Uniform &find_or_add(std::string const &name, Uniform::Type type);
+};
@@ -5,6 +5,7 @@
 #include "MeshBuffer.hpp"
 #include "data_path.hpp"
 #include "gl_errors.hpp"
+#include "GLState.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <cmath>
@@ -117,24 +118,30 @@ void MenuMode::update(float elapsed) {
 	}
 }
 
+void MenuMode::prepare_draw() {
+	if (background) {
+		background->prepare_draw();
+	}
+}
+
 void MenuMode::draw(glm::uvec2 const &drawable_size) {
 	if (background && background_fade < 1.0f) {
 		background->draw(drawable_size);
 
-		glDisable(GL_DEPTH_TEST);
+		GLState::disable(GL_DEPTH_TEST);
 		if (background_fade > 0.0f) {
-			glEnable(GL_BLEND);
-			glBlendEquation(GL_FUNC_ADD);
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-			glUseProgram(*fade_program);
-			glBindVertexArray(*menu_binding); //just have some vao bound
+			GLState::enable(GL_BLEND);
+			GLState::blend_equation(GL_FUNC_ADD);
+			GLState::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			GLState::use_program(*fade_program);
+			GLState::bind_vertex_array(*menu_binding); //just have some vao bound
 			glUniform4fv(fade_program_color, 1, glm::value_ptr(glm::vec4(0.0f, 0.0f, 0.0f, background_fade)));
 			glDrawArrays(GL_TRIANGLES, 0, 3);
-			glUseProgram(0);
-			glDisable(GL_BLEND);
+			GLState::use_program(0);
+			GLState::disable(GL_BLEND);
 		}
 	}
-	glDisable(GL_DEPTH_TEST);
+	GLState::disable(GL_DEPTH_TEST);
 
 	float aspect = drawable_size.x / float(drawable_size.y);
 	//scale factors such that a rectangle of aspect 'aspect' and height '1.0' fills the window:
@@ -151,8 +158,8 @@ void MenuMode::draw(glm::uvec2 const &drawable_size) {
 		total_height += choice.height + 2.0f * choice.padding;
 	}
 
-	glUseProgram(*menu_program);
-	glBindVertexArray(*menu_binding);
+	GLState::use_program(*menu_program);
+	GLState::bind_vertex_array(*menu_binding);
 
 	//character width and spacing helpers:
 	// (...in terms of the menu font's default 3-unit height)
@@ -217,7 +224,7 @@ void MenuMode::draw(glm::uvec2 const &drawable_size) {
 		y -= choice.padding;
 	}
 
-	glEnable(GL_DEPTH_TEST);
+	GLState::enable(GL_DEPTH_TEST);
 
 	GL_ERRORS();
 }
@@ -13,6 +13,9 @@ struct MenuMode : public Mode {
 	virtual void update(float elapsed) override;
 	virtual void draw(glm::uvec2 const &drawable_size) override;
 
+	//(menu state isn't snapshotted, so the menu never draws concurrently; the background still prepares its snapshot)
+	virtual void prepare_draw() override;
+
 	struct Choice {
 		Choice(std::string const &label_, std::function< void() > on_select_ = nullptr) : label(label_), on_select(on_select_) { }
 		std::string label;
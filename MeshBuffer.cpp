@@ -1,38 +1,41 @@
 #include "MeshBuffer.hpp"
+#include "GeometryArena.hpp"
 #include "read_chunk.hpp"
+#include "MappedFile.hpp"
+#include "quantize.hpp"
+#include "optimize_triangles.hpp"
 
 #include <glm/glm.hpp>
 
 #include <stdexcept>
-#include <fstream>
 #include <iostream>
 #include <vector>
 #include <string>
-#include <set>
+#include <unordered_map>
 #include <cstddef>
-
-MeshBuffer::MeshBuffer(std::string const &filename) {
-	glGenBuffers(1, &vbo);
-
-	std::ifstream file(filename, std::ios::binary);
-
-	GLuint total = 0;
-	//read + upload data chunk:
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+MeshBuffer::MeshBuffer(std::string const &filename, bool keep_data, bool weld) {
+	//map the file, so that chunks can be read in place:
+	MappedFile file(filename);
+	uint8_t const *at = file.data;
+	uint8_t const *end = file.data + file.size;
+
+	//find vertex data chunk (as bytes, left in the mapped file) and note its layout:
+	uint8_t const *vertices = nullptr;
+	size_t vertices_size = 0;
+	GLsizei stride = 0;
+	bool quantized = false; //positions are relative to per-mesh boxes (read below)
 	if (filename.size() >= 2 && filename.substr(filename.size()-2) == ".p") {
 		struct Vertex {
 			glm::vec3 Position;
 		};
 		static_assert(sizeof(Vertex) == 3*4, "Vertex is packed.");
 
-		std::vector< Vertex > data;
-		read_chunk(file, "p...", &data);
-
-		//upload data:
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		total = GLuint(data.size()); //store total for later checks on index
+		vertices = read_chunk_in_place(at, end, "p...", &vertices_size);
+		stride = sizeof(Vertex);
 
 		//store attrib locations:
 		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
@@ -44,15 +47,8 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		};
 		static_assert(sizeof(Vertex) == 3*4+3*4, "Vertex is packed.");
 
-		std::vector< Vertex > data;
-		read_chunk(file, "pn..", &data);
-
-		//upload data:
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		total = GLuint(data.size()); //store total for later checks on index
+		vertices = read_chunk_in_place(at, end, "pn..", &vertices_size);
+		stride = sizeof(Vertex);
 
 		//store attrib locations:
 		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
@@ -66,15 +62,8 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		};
 		static_assert(sizeof(Vertex) == 3*4+3*4+4*1, "Vertex is packed.");
 
-		std::vector< Vertex > data;
-		read_chunk(file, "pnc.", &data);
-
-		//upload data:
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		total = GLuint(data.size()); //store total for later checks on index
+		vertices = read_chunk_in_place(at, end, "pnc.", &vertices_size);
+		stride = sizeof(Vertex);
 
 		//store attrib locations:
 		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
@@ -90,15 +79,8 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		};
 		static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
 
-		std::vector< Vertex > data;
-		read_chunk(file, "pnct", &data);
-
-		//upload data:
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		total = GLuint(data.size()); //store total for later checks on index
+		vertices = read_chunk_in_place(at, end, "pnct", &vertices_size);
+		stride = sizeof(Vertex);
 
 		//store attrib locations:
 		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
@@ -106,12 +88,72 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
 		TexCoord = Attrib(2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
 
+	} else if (filename.size() >= 5 && filename.substr(filename.size()-5) == ".qpnc") {
+		//quantized version of .pnc (see quantize.hpp):
+		struct Vertex {
+			QuantizedPosition Position;
+			uint32_t Normal;
+			glm::u8vec4 Color;
+		};
+		static_assert(sizeof(Vertex) == 4*2+4+4*1, "Vertex is packed.");
+
+		vertices = read_chunk_in_place(at, end, "qpnc", &vertices_size);
+		stride = sizeof(Vertex);
+		quantized = true;
+
+		//store attrib locations:
+		Position = Attrib(4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Position));
+		Normal = Attrib(4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Normal));
+		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
+
+	} else if (filename.size() >= 6 && filename.substr(filename.size()-6) == ".qpnct") {
+		//quantized version of .pnct (see quantize.hpp), with half-float texture coordinates:
+		struct Vertex {
+			QuantizedPosition Position;
+			uint32_t Normal;
+			glm::u8vec4 Color;
+			uint16_t TexCoord[2];
+		};
+		static_assert(sizeof(Vertex) == 4*2+4+4*1+2*2, "Vertex is packed.");
+
+		vertices = read_chunk_in_place(at, end, "qpnt", &vertices_size);
+		stride = sizeof(Vertex);
+		quantized = true;
+
+		//store attrib locations:
+		Position = Attrib(4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Position));
+		Normal = Attrib(4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Normal));
+		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
+		TexCoord = Attrib(2, GL_HALF_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
+
 	} else {
 		throw std::runtime_error("Unknown file type '" + filename + "'");
 	}
 
+	if (vertices_size % stride != 0) {
+		throw std::runtime_error("Size of vertex chunk in '" + filename + "' not divisible by vertex size.");
+	}
+	GLuint total = GLuint(vertices_size / stride); //store total for later checks on index
+
+	//(every format starts with a position)
+	auto position = [vertices, stride, quantized](GLuint i, Mesh const &mesh) {
+		glm::vec3 ret;
+		if (quantized) {
+			QuantizedPosition q;
+			std::memcpy(&q, &vertices[size_t(i) * stride], sizeof(q));
+			ret = dequantize_position(q, mesh.position_offset, mesh.position_scale);
+		} else {
+			std::memcpy(&ret, &vertices[size_t(i) * stride], sizeof(ret));
+		}
+		return ret;
+	};
+
 	std::vector< char > strings;
-	read_chunk(file, "str0", &strings);
+	read_chunk(at, end, "str0", &strings);
+
+	//when welding, vertices (and their indices) are collected here, mesh by mesh:
+	std::vector< uint8_t > welded;
+	std::vector< uint32_t > welded_indices;
 
 	{ //read index chunk, add to meshes:
 		struct IndexEntry {
@@ -121,9 +163,24 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
 
 		std::vector< IndexEntry > index;
-		read_chunk(file, "idx0", &index);
+		read_chunk(at, end, "idx0", &index);
+
+		//quantized formats also store the box that each mesh's positions are relative to:
+		struct BoxEntry {
+			glm::vec3 offset, scale;
+		};
+		static_assert(sizeof(BoxEntry) == 24, "Box entry should be packed");
+
+		std::vector< BoxEntry > boxes;
+		if (quantized) {
+			read_chunk(at, end, "box0", &boxes);
+			if (boxes.size() != index.size()) {
+				throw std::runtime_error("box chunk doesn't have one entry per index entry");
+			}
+		}
 
-		for (auto const &entry : index) {
+		for (uint32_t e = 0; e < index.size(); ++e) {
+			IndexEntry const &entry = index[e];
 			if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
 				throw std::runtime_error("index entry has out-of-range name begin/end");
 			}
@@ -134,6 +191,73 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 			Mesh mesh;
 			mesh.start = entry.vertex_begin;
 			mesh.count = entry.vertex_end - entry.vertex_begin;
+			if (quantized) {
+				mesh.position_offset = boxes[e].offset;
+				mesh.position_scale = boxes[e].scale;
+			}
+			if (mesh.count > 0) { //compute bounds:
+				mesh.min = mesh.max = position(mesh.start, mesh);
+				for (GLuint i = mesh.start; i < mesh.start + mesh.count; ++i) {
+					mesh.min = glm::min(mesh.min, position(i, mesh));
+					mesh.max = glm::max(mesh.max, position(i, mesh));
+				}
+				mesh.center = 0.5f * (mesh.min + mesh.max);
+				float radius2 = 0.0f;
+				for (GLuint i = mesh.start; i < mesh.start + mesh.count; ++i) {
+					glm::vec3 d = position(i, mesh) - mesh.center;
+					radius2 = std::max(radius2, glm::dot(d, d));
+				}
+				mesh.radius = std::sqrt(radius2);
+			}
+			if (weld) { //merge byte-identical vertices within the mesh, then reorder its triangles:
+				auto hash = [vertices, stride](GLuint i) {
+					//(FNV-1a)
+					size_t h = 2166136261u;
+					for (GLsizei b = 0; b < stride; ++b) {
+						h = (h ^ vertices[size_t(i) * stride + b]) * 16777619u;
+					}
+					return h;
+				};
+				auto equal = [vertices, stride](GLuint a, GLuint b) {
+					return std::memcmp(&vertices[size_t(a) * stride], &vertices[size_t(b) * stride], stride) == 0;
+				};
+				//source vertex -> index of its first copy (among the mesh's welded vertices):
+				std::unordered_map< GLuint, uint32_t, decltype(hash), decltype(equal) > seen(2 * mesh.count, hash, equal);
+
+				std::vector< GLuint > sources; //source vertex of each welded vertex
+				std::vector< uint32_t > mesh_indices;
+				mesh_indices.reserve(mesh.count);
+				for (GLuint i = mesh.start; i < mesh.start + mesh.count; ++i) {
+					auto f = seen.insert(std::make_pair(i, uint32_t(sources.size())));
+					if (f.second) sources.emplace_back(i);
+					mesh_indices.emplace_back(f.first->second);
+				}
+
+				//(see optimize_triangles.hpp)
+				if (mesh_indices.size() % 3 == 0) {
+					std::vector< glm::vec3 > positions(sources.size());
+					for (uint32_t v = 0; v < sources.size(); ++v) {
+						positions[v] = position(sources[v], mesh);
+					}
+					std::vector< uint32_t > order = optimize_triangles(mesh_indices, positions);
+					for (uint32_t v = 0; v < order.size(); ++v) {
+						order[v] = sources[order[v]];
+					}
+					sources = std::move(order);
+				}
+
+				GLuint start = GLuint(welded.size() / stride);
+				for (GLuint i : sources) {
+					welded.insert(welded.end(), vertices + size_t(i) * stride, vertices + size_t(i + 1) * stride);
+				}
+				mesh.index_start = GLuint(welded_indices.size());
+				mesh.index_count = GLuint(mesh_indices.size());
+				for (uint32_t v : mesh_indices) {
+					welded_indices.emplace_back(start + v);
+				}
+				mesh.start = start;
+				mesh.count = GLuint(sources.size());
+			}
 			bool inserted = meshes.insert(std::make_pair(name, mesh)).second;
 			if (!inserted) {
 				std::cerr << "WARNING: mesh name '" + name + "' in filename '" + filename + "' collides with existing mesh." << std::endl;
@@ -141,10 +265,27 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		}
 	}
 
-	if (file.peek() != EOF) {
+	if (at != end) {
 		std::cerr << "WARNING: trailing data in mesh file '" << filename << "'" << std::endl;
 	}
 
+	if (weld) {
+		upload(welded.data(), welded.size(), welded_indices);
+		if (keep_data) {
+			data = std::move(welded);
+			indices = std::move(welded_indices);
+		}
+	} else {
+		upload(vertices, vertices_size, std::vector< uint32_t >()); //(straight from the mapped file)
+		if (keep_data) data.assign(vertices, vertices + vertices_size);
+	}
+
+	//meshes refer to their data's place in the arena:
+	for (auto &name_mesh : meshes) {
+		name_mesh.second.start += vertex_base;
+		name_mesh.second.index_start += index_base;
+	}
+
 	/* //DEBUG:
 	std::cout << "File '" << filename << "' contained meshes";
 	for (auto const &m : meshes) {
@@ -156,6 +297,27 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 	*/
 }
 
+MeshBuffer::MeshBuffer(MeshBuffer const &format, std::vector< uint8_t > const &vertex_data, std::vector< uint32_t > const &indices) {
+	Position = format.Position;
+	Normal = format.Normal;
+	Color = format.Color;
+	TexCoord = format.TexCoord;
+
+	upload(vertex_data.data(), vertex_data.size(), indices);
+}
+
+void MeshBuffer::upload(uint8_t const *vertex_data, size_t vertex_bytes, std::vector< uint32_t > const &indices) {
+	GeometryArena::Range range = GeometryArena::allocate(*this, vertex_data, vertex_bytes, indices);
+	block = range.block;
+	vbo = block->vbo;
+	vertex_base = range.vertex_base;
+	if (!indices.empty()) {
+		ebo = block->ebo;
+		index_type = block->index_type;
+		index_base = range.index_base;
+	}
+}
+
 const MeshBuffer::Mesh &MeshBuffer::lookup(std::string const &name) const {
 	auto f = meshes.find(name);
 	if (f == meshes.end()) {
@@ -164,48 +326,53 @@ const MeshBuffer::Mesh &MeshBuffer::lookup(std::string const &name) const {
 	return f->second;
 }
 
-GLuint MeshBuffer::make_vao_for_program(GLuint program) const {
-	//create a new vertex array object:
-	GLuint vao = 0;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
-	//Try to bind all attributes in this buffer:
-	std::set< GLuint > bound;
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	auto bind_attribute = [&](char const *name, MeshBuffer::Attrib const &attrib) {
-		if (attrib.size == 0) return; //don't bind empty attribs
-		GLint location = glGetAttribLocation(program, name);
-		if (location == -1) {
-			std::cerr << "WARNING: attribute '" << name << "' in mesh buffer isn't active in program." << std::endl;
+std::vector< MeshBuffer::Mesh const * > MeshBuffer::lookup_lods(std::string const &name) const {
+	std::vector< Mesh const * > ret;
+	while (true) {
+		auto f = meshes.find(name + ".LOD" + std::to_string(ret.size() + 1));
+		if (f == meshes.end()) break;
+		ret.emplace_back(&f->second);
+	}
+	return ret;
+}
+
+std::vector< glm::vec3 > MeshBuffer::read_positions(Mesh const &mesh) const {
+	if (data.empty()) {
+		throw std::runtime_error("Reading positions from a mesh buffer that didn't keep its data.");
+	}
+	if (!quantized() && (Position.type != GL_FLOAT || Position.size < 3)) {
+		throw std::runtime_error("Reading positions from a mesh buffer that doesn't store them as floats or quantized positions.");
+	}
+	auto position = [&](GLuint v) {
+		glm::vec3 ret;
+		if (quantized()) {
+			QuantizedPosition q;
+			std::memcpy(&q, &data[v * Position.stride + Position.offset], sizeof(q));
+			ret = dequantize_position(q, mesh.position_offset, mesh.position_scale);
 		} else {
-			glVertexAttribPointer(location, attrib.size, attrib.type, attrib.normalized, attrib.stride, (GLbyte *)0 + attrib.offset);
-			glEnableVertexAttribArray(location);
-			bound.insert(location);
+			std::memcpy(&ret, &data[v * Position.stride + Position.offset], sizeof(ret));
 		}
+		return ret;
 	};
-	bind_attribute("Position", Position);
-	bind_attribute("Normal", Normal);
-	bind_attribute("Color", Color);
-	bind_attribute("TexCoord", TexCoord);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-
-	//Check that all active attributes were bound:
-	GLint active = 0;
-	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &active);
-	assert(active >= 0 && "Doesn't makes sense to have negative active attributes.");
-	for (GLuint i = 0; i < GLuint(active); ++i) {
-		GLchar name[100];
-		GLint size = 0;
-		GLenum type = 0;
-		glGetActiveAttrib(program, i, 100, NULL, &size, &type, name);
-		name[99] = '\0';
-		GLint location = glGetAttribLocation(program, name);
-		if (!bound.count(GLuint(location))) {
-			throw std::runtime_error("ERROR: active attribute '" + std::string(name) + "' in program is not bound.");
+	//(the CPU copies don't include the rest of the arena)
+	if (index_type != 0) {
+		std::vector< glm::vec3 > positions(mesh.index_count);
+		for (GLuint i = 0; i < mesh.index_count; ++i) {
+			positions[i] = position(indices[mesh.index_start - index_base + i]);
 		}
+		return positions;
+	}
+	std::vector< glm::vec3 > positions(mesh.count);
+	for (GLuint i = 0; i < mesh.count; ++i) {
+		positions[i] = position(mesh.start - vertex_base + i);
 	}
+	return positions;
+}
+
+GLuint MeshBuffer::make_vao_for_program(GLuint program) const {
+	return GeometryArena::vao_for_program(*block, program);
+}
 
-	return vao;
+GLuint MeshBuffer::make_position_vao() const {
+	return GeometryArena::position_vao(*block);
 }
@@ -1,13 +1,28 @@
 #pragma once
 
 #include "GL.hpp"
+
+#include <glm/glm.hpp>
+
 #include <map>
+#include <vector>
+#include <string>
+
+namespace GeometryArena { struct Block; }
 
 //"MeshBuffer" holds a collection of meshes loaded from a file
-// (note that meshes in a single collection will share a vbo/vao)
+// (note that the meshes' data is stored in the shared GeometryArena, so meshes from every
+//  MeshBuffer with the same vertex layout will usually share a vbo/vao)
 
 struct MeshBuffer {
-	GLuint vbo = 0; //OpenGL vertex buffer object containing the meshes' data
+	GLuint vbo = 0; //OpenGL vertex buffer object containing the meshes' data (shared; see GeometryArena.hpp)
+	GLuint ebo = 0; //OpenGL element buffer object with the meshes' indices (only if indexed; also shared)
+	GLenum index_type = 0; //type of indices in ebo (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT), or 0 if not indexed
+
+	//this buffer's part of the arena:
+	GeometryArena::Block *block = nullptr;
+	GLuint vertex_base = 0; //first vertex in vbo
+	GLuint index_base = 0; //first index in ebo
 
 	//Attrib includes location within the vertex buffer of various attributes:
 	// (exactly the parameters to glVertexAttribPointer)
@@ -28,24 +43,72 @@ struct MeshBuffer {
 	Attrib Color;
 	Attrib TexCoord;
 
+	//quantized buffers (.qpnc, .qpnct -- see quantize.hpp and meshes/quantize-meshes.py) store:
+	// - positions as 16-bit normalized values within each mesh's box (position_offset, position_scale),
+	// - normals as GL_INT_2_10_10_10_REV,
+	// - texture coordinates (if any) as half floats.
+	bool quantized() const { return Position.type == GL_UNSIGNED_SHORT; }
+
 
 	//construct from a file:
 	// note: will throw if file fails to read.
-	MeshBuffer(std::string const &filename);
+	// (file types: .p, .pn, .pnc, .pnct, and the quantized .qpnc, .qpnct)
+	// if 'keep_data' is true, a copy of the vertex data is kept in 'data' (e.g., for bake_static)
+	// if 'weld' is true, byte-identical vertices within each mesh are merged, and the buffer
+	//  is indexed: meshes should be drawn with glDrawElements using index_start/index_count
+	//  (each mesh's triangles and vertices are also reordered for the vertex cache and overdraw; see optimize_triangles.hpp)
+	MeshBuffer(std::string const &filename, bool keep_data = false, bool weld = false);
+
+	//construct from vertex data laid out as in 'format' (attribs are copied, meshes are left empty):
+	// (if 'indices' are given, the buffer is indexed)
+	MeshBuffer(MeshBuffer const &format, std::vector< uint8_t > const &vertex_data, std::vector< uint32_t > const &indices = std::vector< uint32_t >());
+
+	//CPU copy of this buffer's vertex data in vbo (only if constructed with keep_data):
+	std::vector< uint8_t > data;
+	//CPU copy of this buffer's indices in ebo (only if constructed with keep_data and weld):
+	// (indices[i] is index_base + i in ebo, and refers to data's vertices, i.e., is relative to vertex_base)
+	std::vector< uint32_t > indices;
 
 	//look up a particular mesh in the DB:
 	// note: will throw if mesh not found.
 	struct Mesh {
-		GLuint start = 0;
+		GLuint start = 0; //range of vertices in vbo (so includes vertex_base)
 		GLuint count = 0;
+		GLuint index_start = 0; //range of indices in ebo (if indexed; includes index_base)
+		GLuint index_count = 0;
+		//bounding volumes (in mesh-local coordinates), computed at load time:
+		glm::vec3 min = glm::vec3(0.0f); //axis-aligned box
+		glm::vec3 max = glm::vec3(0.0f);
+		glm::vec3 center = glm::vec3(0.0f); //sphere (centered on the box)
+		float radius = 0.0f;
+		//stored positions map to mesh-local ones as position_offset + position_scale * position
+		// (only quantized buffers use anything but the identity; set Scene::Object's matching fields from these):
+		glm::vec3 position_offset = glm::vec3(0.0f);
+		glm::vec3 position_scale = glm::vec3(1.0f);
 	};
 	const Mesh &lookup(std::string const &name) const;
+
+	//look up the coarser versions of a mesh, named "<name>.LOD1", "<name>.LOD2", ...:
+	// (stops at the first missing level, so returns an empty list if there are none)
+	std::vector< Mesh const * > lookup_lods(std::string const &name) const;
+
+	//copy the (mesh-local) vertex positions of a mesh's triangles, three per triangle (e.g., to use as an occluder):
+	// note: requires keep_data, and will throw if positions aren't stored as floats or quantized.
+	std::vector< glm::vec3 > read_positions(Mesh const &mesh) const;
 	
-	//build a vertex array object that links this vbo to attributes to a program:
+	//get a vertex array object that links this vbo to attributes to a program:
 	//  will throw if program defines attributes not contained in this buffer
 	//  and warn if this buffer contains attributes not active in the program
+	// (made on first use, and shared by every MeshBuffer in the same arena block)
 	GLuint make_vao_for_program(GLuint program) const;
 
+	//get a vertex array object with only the Position attribute (bound to location 0):
+	// (e.g., for depth_program; works with any program that reads Position from location 0; also shared)
+	GLuint make_position_vao() const;
+
 	//internals:
 	std::map< std::string, Mesh > meshes;
+
+	//copy vertex data (and indices, if any) to the arena, and note where they went:
+	void upload(uint8_t const *vertex_data, size_t vertex_bytes, std::vector< uint32_t > const &indices);
 };
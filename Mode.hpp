@@ -21,6 +21,14 @@ public:
 	//draw is called after update:
 	virtual void draw(glm::uvec2 const &drawable_size) = 0;
 
+	//With main.cpp's --render-thread option, draw runs on its own thread, one frame behind update:
+	// prepare_draw is called (on the main thread) after update, and should copy whatever draw
+	//  reads into a snapshot (e.g., a DoubleBuffer) that stays valid while the next events and update run.
+	// Modes that do this return true from draws_concurrently; for other modes, the main thread
+	//  waits for draw to finish before handling the next frame's events.
+	virtual void prepare_draw() { }
+	virtual bool draws_concurrently() const { return false; }
+
 	//Mode::current is the Mode to which events are dispatched.
 	// use 'set_current' to change the current Mode (e.g., to switch to a menu)
 	static std::shared_ptr< Mode > current;
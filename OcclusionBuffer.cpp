@@ -0,0 +1,198 @@
+#include "OcclusionBuffer.hpp"
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define OCCLUSION_BUFFER_USE_SSE 1
+#include <xmmintrin.h>
+#endif
+
+//vertices closer than this (in clip w) are treated as crossing the near plane:
+static float const MinW = 1e-3f;
+
+OcclusionBuffer::OcclusionBuffer(uint32_t width_, uint32_t height_) {
+	width = std::max(1U, (width_ + TileSize - 1) / TileSize) * TileSize;
+	height = std::max(1U, (height_ + TileSize - 1) / TileSize) * TileSize;
+	depth.assign(width * height, 0.0f);
+	tile_far.assign((width / TileSize) * (height / TileSize), 0.0f);
+}
+
+void OcclusionBuffer::clear() {
+	std::fill(depth.begin(), depth.end(), 0.0f);
+	std::fill(tile_far.begin(), tile_far.end(), 0.0f);
+	vertices.clear();
+}
+
+void OcclusionBuffer::add_occluder(glm::mat4 const &object_to_clip, std::vector< glm::vec3 > const &triangles) {
+	assert(triangles.size() % 3 == 0 && "Occluders are lists of triangles.");
+	for (uint32_t t = 0; t + 2 < triangles.size(); t += 3) {
+		ScreenVertex v[3];
+		bool crosses_near = false;
+		for (uint32_t i = 0; i < 3; ++i) {
+			glm::vec4 clip = object_to_clip * glm::vec4(triangles[t + i], 1.0f);
+			if (clip.w < MinW) {
+				crosses_near = true;
+				break;
+			}
+			float inv_w = 1.0f / clip.w;
+			v[i].x = (clip.x * inv_w * 0.5f + 0.5f) * width;
+			v[i].y = (clip.y * inv_w * 0.5f + 0.5f) * height;
+			v[i].z = inv_w;
+		}
+		if (crosses_near) continue;
+		//skip triangles entirely off one side of the screen:
+		if (std::max(v[0].x, std::max(v[1].x, v[2].x)) < 0.0f || std::min(v[0].x, std::min(v[1].x, v[2].x)) > float(width)) continue;
+		if (std::max(v[0].y, std::max(v[1].y, v[2].y)) < 0.0f || std::min(v[0].y, std::min(v[1].y, v[2].y)) > float(height)) continue;
+		vertices.emplace_back(v[0]);
+		vertices.emplace_back(v[1]);
+		vertices.emplace_back(v[2]);
+	}
+}
+
+void OcclusionBuffer::rasterize() {
+	//each band of TileSize rows covers one row of tiles, so bands never touch the same memory:
+	WorkerPool::get().parallel_for(height / TileSize, 1, [this](uint32_t begin, uint32_t end){
+		for (uint32_t band = begin; band < end; ++band) {
+			rasterize_rows(band * TileSize, (band + 1) * TileSize);
+
+			//update the farthest depth of each tile in this band:
+			for (uint32_t tx = 0; tx < width / TileSize; ++tx) {
+				float least = depth[band * TileSize * width + tx * TileSize];
+				for (uint32_t y = band * TileSize; y < (band + 1) * TileSize; ++y) {
+					float const *row = &depth[y * width + tx * TileSize];
+					for (uint32_t x = 0; x < TileSize; ++x) {
+						least = std::min(least, row[x]);
+					}
+				}
+				tile_far[band * (width / TileSize) + tx] = least;
+			}
+		}
+	});
+}
+
+void OcclusionBuffer::rasterize_rows(uint32_t row_begin, uint32_t row_end) {
+	for (uint32_t t = 0; t + 2 < vertices.size(); t += 3) {
+		ScreenVertex a = vertices[t+0];
+		ScreenVertex b = vertices[t+1];
+		ScreenVertex c = vertices[t+2];
+
+		//twice the signed area; flip to counterclockwise, since occluders are double-sided:
+		float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+		if (area < 0.0f) {
+			std::swap(b, c);
+			area = -area;
+		}
+		if (area < 1e-8f) continue;
+
+		//pixel bounds of the triangle, clipped to the band:
+		int32_t min_x = std::max(0, int32_t(std::floor(std::min(a.x, std::min(b.x, c.x)))));
+		int32_t max_x = std::min(int32_t(width) - 1, int32_t(std::floor(std::max(a.x, std::max(b.x, c.x)))));
+		int32_t min_y = std::max(int32_t(row_begin), int32_t(std::floor(std::min(a.y, std::min(b.y, c.y)))));
+		int32_t max_y = std::min(int32_t(row_end) - 1, int32_t(std::floor(std::max(a.y, std::max(b.y, c.y)))));
+		if (min_x > max_x || min_y > max_y) continue;
+
+		//edge functions (positive inside) of the form e = A * x + B * y + C:
+		float A[3], B[3], C[3];
+		ScreenVertex const *from[3] = {&b, &c, &a};
+		ScreenVertex const *to[3] = {&c, &a, &b};
+		for (uint32_t i = 0; i < 3; ++i) {
+			A[i] = from[i]->y - to[i]->y;
+			B[i] = to[i]->x - from[i]->x;
+			C[i] = -(A[i] * from[i]->x + B[i] * from[i]->y);
+		}
+
+		//depth plane z = zx * x + zy * y + zc:
+		float zx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+		float zy = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / area;
+		float zc = a.z - zx * a.x - zy * a.y;
+
+		//(sample at pixel centers)
+#ifdef OCCLUSION_BUFFER_USE_SSE
+		min_x &= ~3; //(rows are a multiple of four pixels wide, so this stays in bounds)
+		__m128 const offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		__m128 const zero = _mm_setzero_ps();
+		for (int32_t y = min_y; y <= max_y; ++y) {
+			float py = y + 0.5f;
+			__m128 e0_row = _mm_set1_ps(B[0] * py + C[0]);
+			__m128 e1_row = _mm_set1_ps(B[1] * py + C[1]);
+			__m128 e2_row = _mm_set1_ps(B[2] * py + C[2]);
+			__m128 z_row = _mm_set1_ps(zy * py + zc);
+			float *row = &depth[y * width];
+			for (int32_t x = min_x; x <= max_x; x += 4) {
+				__m128 px = _mm_add_ps(_mm_set1_ps(float(x)), offsets);
+				__m128 e0 = _mm_add_ps(e0_row, _mm_mul_ps(_mm_set1_ps(A[0]), px));
+				__m128 e1 = _mm_add_ps(e1_row, _mm_mul_ps(_mm_set1_ps(A[1]), px));
+				__m128 e2 = _mm_add_ps(e2_row, _mm_mul_ps(_mm_set1_ps(A[2]), px));
+				__m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+				__m128 z = _mm_add_ps(z_row, _mm_mul_ps(_mm_set1_ps(zx), px));
+				//keep the nearest (largest) depth; outside pixels contribute 0, which never wins:
+				_mm_storeu_ps(row + x, _mm_max_ps(_mm_loadu_ps(row + x), _mm_and_ps(inside, z)));
+			}
+		}
+#else
+		for (int32_t y = min_y; y <= max_y; ++y) {
+			float py = y + 0.5f;
+			float *row = &depth[y * width];
+			for (int32_t x = min_x; x <= max_x; ++x) {
+				float px = x + 0.5f;
+				if (A[0] * px + B[0] * py + C[0] < 0.0f) continue;
+				if (A[1] * px + B[1] * py + C[1] < 0.0f) continue;
+				if (A[2] * px + B[2] * py + C[2] < 0.0f) continue;
+				row[x] = std::max(row[x], zx * px + zy * py + zc);
+			}
+		}
+#endif
+	}
+}
+
+bool OcclusionBuffer::is_box_occluded(glm::mat4 const &object_to_clip, glm::vec3 const &min, glm::vec3 const &max) const {
+	//screen-space bounds and nearest depth of the box's corners:
+	float min_x = float(width), max_x = 0.0f;
+	float min_y = float(height), max_y = 0.0f;
+	float nearest = 0.0f;
+	for (uint32_t i = 0; i < 8; ++i) {
+		glm::vec4 corner = glm::vec4(
+			(i & 1 ? max.x : min.x),
+			(i & 2 ? max.y : min.y),
+			(i & 4 ? max.z : min.z),
+			1.0f
+		);
+		glm::vec4 clip = object_to_clip * corner;
+		if (clip.w < MinW) return false; //box crosses the near plane, so it's surely visible
+		float inv_w = 1.0f / clip.w;
+		float x = (clip.x * inv_w * 0.5f + 0.5f) * width;
+		float y = (clip.y * inv_w * 0.5f + 0.5f) * height;
+		min_x = std::min(min_x, x); max_x = std::max(max_x, x);
+		min_y = std::min(min_y, y); max_y = std::max(max_y, y);
+		nearest = std::max(nearest, inv_w);
+	}
+
+	int32_t x0 = std::max(0, int32_t(std::floor(min_x)));
+	int32_t x1 = std::min(int32_t(width) - 1, int32_t(std::floor(max_x)));
+	int32_t y0 = std::max(0, int32_t(std::floor(min_y)));
+	int32_t y1 = std::min(int32_t(height) - 1, int32_t(std::floor(max_y)));
+	if (x0 > x1 || y0 > y1) return false; //(off screen; leave that to frustum culling)
+
+	uint32_t tiles_x = width / TileSize;
+	for (int32_t ty = y0 / int32_t(TileSize); ty <= y1 / int32_t(TileSize); ++ty) {
+		for (int32_t tx = x0 / int32_t(TileSize); tx <= x1 / int32_t(TileSize); ++tx) {
+			//every pixel in the tile is nearer than the box:
+			if (nearest < tile_far[ty * tiles_x + tx]) continue;
+
+			//otherwise, check the pixels of the tile that the box covers:
+			int32_t px0 = std::max(x0, tx * int32_t(TileSize));
+			int32_t px1 = std::min(x1, (tx + 1) * int32_t(TileSize) - 1);
+			int32_t py0 = std::max(y0, ty * int32_t(TileSize));
+			int32_t py1 = std::min(y1, (ty + 1) * int32_t(TileSize) - 1);
+			for (int32_t y = py0; y <= py1; ++y) {
+				for (int32_t x = px0; x <= px1; ++x) {
+					if (depth[y * width + x] <= nearest) return false;
+				}
+			}
+		}
+	}
+	return true;
+}
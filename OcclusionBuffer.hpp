@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+//"OcclusionBuffer" is a low-resolution software depth buffer used to skip objects hidden behind occluders:
+//
+//  buffer.clear();
+//  buffer.add_occluder(object_to_clip, triangles); //for each occluder
+//  buffer.rasterize(); //draw all occluders (bands of rows are spread across worker threads)
+//  if (buffer.is_box_occluded(object_to_clip, min, max)) { /* don't draw */ }
+//
+// Depth is stored as 1/w (clip w is view depth), which interpolates linearly in screen space;
+// larger values are nearer, and 0 means nothing was drawn.
+// Each pixel keeps its nearest occluder, and each TileSize x TileSize tile also keeps its
+// farthest pixel, so most tests can be answered from the tiles alone.
+//
+// Occluders are drawn double-sided. Triangles that cross the near plane are skipped, which
+// can only make culling less aggressive.
+
+struct OcclusionBuffer {
+	//(width and height are rounded up to multiples of TileSize)
+	OcclusionBuffer(uint32_t width = 256, uint32_t height = 128);
+
+	enum : uint32_t { TileSize = 8 }; //(also a multiple of the four pixels processed at once with SSE)
+	uint32_t width, height;
+	std::vector< float > depth; //width x height, row-major, bottom row first
+	std::vector< float > tile_far; //(width / TileSize) x (height / TileSize): least depth in each tile
+
+	//occluder triangles in pixel coordinates (z is 1/w), three vertices each, waiting for rasterize():
+	struct ScreenVertex {
+		float x, y, z;
+	};
+	std::vector< ScreenVertex > vertices;
+
+	//remove all occluders and reset depth:
+	void clear();
+
+	//queue a triangle list (three object-space vertices per triangle) for drawing:
+	void add_occluder(glm::mat4 const &object_to_clip, std::vector< glm::vec3 > const &triangles);
+
+	//draw queued occluders into depth, then compute tile_far:
+	void rasterize();
+
+	//is the box [min,max] (in object space) entirely behind occluders?
+	// (safe to call from several threads at once)
+	bool is_box_occluded(glm::mat4 const &object_to_clip, glm::vec3 const &min, glm::vec3 const &max) const;
+
+	//------ internals ------
+
+	//draw all queued triangles, clipped to rows [row_begin, row_end):
+	void rasterize_rows(uint32_t row_begin, uint32_t row_end);
+};
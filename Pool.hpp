@@ -0,0 +1,156 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <type_traits>
+#include <cassert>
+#include <cstdint>
+
+//"Pool" allocates objects of type T from large contiguous blocks:
+// - pointers to allocated objects remain valid until the object is deleted (blocks never move)
+// - new_item and delete_item are O(1) (deleted slots go on a free list and are reused)
+// - iteration visits live objects in memory order
+//
+// Pool< Thing > things;
+// Thing *thing = things.new_item(arg1, arg2); //like 'new Thing(arg1, arg2)'
+// for (Thing &t : things) { ... }
+// things.delete_item(thing); //like 'delete thing'
+
+template< typename T >
+struct Pool {
+	//number of slots allocated at once when the pool runs out:
+	enum : uint32_t { DefaultBlockSize = 256 };
+
+	Pool() = default;
+	Pool(Pool const &) = delete;
+	Pool &operator=(Pool const &) = delete;
+	~Pool() { clear(); }
+
+	//construct a new item in a free slot:
+	template< typename... Args >
+	T *new_item(Args&&... args) {
+		if (!free_slots) add_block(DefaultBlockSize);
+		Slot *slot = free_slots;
+		new (&slot->storage) T(std::forward< Args >(args)...); //construct first, in case the constructor throws
+		free_slots = slot->next_free;
+		slot->next_free = nullptr;
+		slot->live = true;
+		++live_count;
+		return slot->get();
+	}
+
+	//destroy an item and return its slot to the free list:
+	void delete_item(T *t) {
+		assert(t && "It is invalid to delete a null pool item.");
+		Slot *slot = reinterpret_cast< Slot * >(t);
+		assert(slot->live && "Deleting an item that isn't live (double delete?)");
+		slot->live = false; //mark first so that the destructor can't observe a live-but-destroyed slot
+		t->~T();
+		slot->next_free = free_slots;
+		free_slots = slot;
+		--live_count;
+	}
+
+	//make sure at least 'count' items can be allocated without creating new blocks:
+	// (if the first 'count' free slots aren't already one run in memory order, a new block of 'count' slots is made;
+	//  either way, the next 'count' items allocated are adjacent in memory, in allocation order)
+	void reserve(uint32_t count) {
+		if (count == 0) return;
+		uint32_t run = 0;
+		for (Slot *s = free_slots; s && run < count; s = s->next_free) {
+			++run;
+			if (run < count && s->next_free != s + 1) break; //(next free slot isn't adjacent)
+		}
+		if (run < count) add_block(count);
+	}
+
+	//destroy all items:
+	void clear() {
+		for (auto &block : blocks) {
+			for (uint32_t i = 0; i < block.size; ++i) {
+				Slot &slot = block.slots[i];
+				if (slot.live) {
+					slot.live = false;
+					slot.get()->~T();
+				}
+			}
+		}
+		blocks.clear();
+		free_slots = nullptr;
+		live_count = 0;
+	}
+
+	uint32_t size() const { return live_count; }
+	bool empty() const { return live_count == 0; }
+
+	//------ internals ------
+	struct Slot {
+		typename std::aligned_storage< sizeof(T), alignof(T) >::type storage; //must be first (see delete_item)
+		Slot *next_free = nullptr;
+		bool live = false;
+		T *get() { return reinterpret_cast< T * >(&storage); }
+	};
+	static_assert(std::is_standard_layout< Slot >::value, "Slot must be standard layout so T * can be converted to Slot *.");
+
+	struct Block {
+		std::unique_ptr< Slot[] > slots;
+		uint32_t size = 0;
+	};
+
+	void add_block(uint32_t size) {
+		assert(size > 0);
+		blocks.emplace_back();
+		Block &block = blocks.back();
+		block.slots.reset(new Slot[size]);
+		block.size = size;
+		//thread slots onto free list back-to-front so they are handed out in memory order:
+		for (uint32_t i = size; i > 0; --i) {
+			block.slots[i-1].next_free = free_slots;
+			free_slots = &block.slots[i-1];
+		}
+	}
+
+	std::vector< Block > blocks;
+	Slot *free_slots = nullptr;
+	uint32_t live_count = 0;
+
+	//------ iteration over live items ------
+	// (deleting the item currently being visited is allowed; iteration continues with the next slot)
+	template< typename V >
+	struct Iterator {
+		Iterator(std::vector< Block > const *blocks_, size_t block_, uint32_t index_) : blocks(blocks_), block(block_), index(index_) {
+			skip_dead();
+		}
+		V &operator*() const { return *(*blocks)[block].slots[index].get(); }
+		V *operator->() const { return (*blocks)[block].slots[index].get(); }
+		Iterator &operator++() {
+			++index;
+			skip_dead();
+			return *this;
+		}
+		bool operator==(Iterator const &o) const { return block == o.block && index == o.index; }
+		bool operator!=(Iterator const &o) const { return !(*this == o); }
+
+		void skip_dead() {
+			while (block < blocks->size()) {
+				Block const &b = (*blocks)[block];
+				while (index < b.size && !b.slots[index].live) ++index;
+				if (index < b.size) return;
+				++block;
+				index = 0;
+			}
+		}
+
+		std::vector< Block > const *blocks;
+		size_t block;
+		uint32_t index;
+	};
+	typedef Iterator< T > iterator;
+	typedef Iterator< T const > const_iterator;
+
+	iterator begin() { return iterator(&blocks, 0, 0); }
+	iterator end() { return iterator(&blocks, blocks.size(), 0); }
+	const_iterator begin() const { return const_iterator(&blocks, 0, 0); }
+	const_iterator end() const { return const_iterator(&blocks, blocks.size(), 0); }
+};
@@ -0,0 +1,601 @@
+#include "RenderQueue.hpp"
+#include "WorkerPool.hpp"
+#include "GLState.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+RenderQueue::~RenderQueue() {
+	if (instance_texture != 0) {
+		glDeleteTextures(1, &instance_texture);
+		instance_texture = 0;
+	}
+	if (instance_buffer != 0) {
+		glDeleteBuffers(1, &instance_buffer);
+		instance_buffer = 0;
+	}
+	for (auto &query : samples_queries) {
+		if (query != 0) {
+			glDeleteQueries(1, &query);
+			query = 0;
+		}
+	}
+}
+
+void RenderQueue::clear() {
+	packet.clear();
+}
+
+void RenderQueue::add(Scene const &scene) {
+	packet.add(scene);
+}
+
+void RenderQueue::draw(Scene::Camera const *camera, Scene::DrawStats *stats) {
+	assert(camera && "Must have a camera to draw from.");
+	packet.set_camera(camera);
+	draw(packet, camera->aspect, stats);
+}
+
+//draw triangles from the bound vao: 'count' vertices from 'start' or, if index_type is set,
+// 'count' indices from 'start' in its element buffer:
+static void draw_triangles(GLenum index_type, GLuint start, GLuint count, GLsizei instances = 1) {
+	if (index_type == 0) {
+		if (instances == 1) glDrawArrays(GL_TRIANGLES, start, count);
+		else glDrawArraysInstanced(GL_TRIANGLES, start, count, instances);
+		return;
+	}
+	size_t index_size = (index_type == GL_UNSIGNED_SHORT ? 2 : index_type == GL_UNSIGNED_BYTE ? 1 : 4);
+	GLvoid const *offset = (GLbyte const *)0 + start * index_size;
+	if (instances == 1) glDrawElements(GL_TRIANGLES, count, index_type, offset);
+	else glDrawElementsInstanced(GL_TRIANGLES, count, index_type, offset, instances);
+}
+
+//'to' followed by the object's position decoding (see Scene::Object::position_offset), for passing to programs:
+// (culling and occlusion tests use the undecoded matrices, since bounding boxes are in object space)
+static glm::mat4 with_position_decode(glm::mat4 const &to, Scene::Object const &object) {
+	return glm::mat4(
+		to[0] * object.position_scale.x,
+		to[1] * object.position_scale.y,
+		to[2] * object.position_scale.z,
+		to * glm::vec4(object.position_offset, 1.0f)
+	);
+}
+
+//returns true if the box [min,max] is entirely outside the clip volume of the matrix 'mvp':
+// (planes are extracted from the rows of the matrix; there is no far plane since projections are infinite)
+static bool bbox_outside_clip(glm::mat4 const &mvp, glm::vec3 const &min, glm::vec3 const &max) {
+	glm::vec4 row[4];
+	for (uint32_t r = 0; r < 4; ++r) {
+		row[r] = glm::vec4(mvp[0][r], mvp[1][r], mvp[2][r], mvp[3][r]);
+	}
+	glm::vec4 planes[5] = {
+		row[3] + row[0], //left
+		row[3] - row[0], //right
+		row[3] + row[1], //bottom
+		row[3] - row[1], //top
+		row[3] + row[2], //near
+	};
+	for (auto const &plane : planes) {
+		//corner of the box furthest along the plane normal:
+		glm::vec3 corner = glm::vec3(
+			(plane.x > 0.0f ? max.x : min.x),
+			(plane.y > 0.0f ? max.y : min.y),
+			(plane.z > 0.0f ? max.z : min.z)
+		);
+		if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.0f) return true;
+	}
+	return false;
+}
+
+//view depth as sortable bits (non-negative floats order the same way as their bit patterns):
+static inline uint32_t depth_bits(float depth) {
+	depth = std::max(depth, 0.0f);
+	uint32_t bits;
+	std::memcpy(&bits, &depth, sizeof(bits));
+	return bits;
+}
+
+//sort key for the render queue; objects with equal keys can share program, material, and vao binds.
+// Within a (program, material, vao) group, objects that could be instanced are ordered by mesh (so copies
+// of a mesh end up next to each other), and the rest are ordered front-to-back if 'front_to_back' is set
+// (so nearer objects fill the depth buffer first and hide fragments of those behind them):
+//   bits 63-48: program, 47-36: material, 35-24: vao, 23-0: depth (top bits) or mesh start
+// (GL object names are small integers in practice, so radix sort will only need a few passes;
+//  if names or material addresses ever collide in these bits, sorting is merely less effective)
+static inline uint64_t make_sort_key(Scene::Object const &object, RenderQueue::PreparedObject const &p, bool front_to_back) {
+	uint64_t material = uint64_t(reinterpret_cast< uintptr_t >(object.material) / sizeof(Material));
+	uint64_t key = (uint64_t(object.program & 0xffff) << 48) | ((material & 0xfff) << 36) | (uint64_t(object.vao & 0xfff) << 24);
+	if (front_to_back && object.instanced_program == 0) {
+		key |= uint64_t(depth_bits(p.depth) >> 8);
+	} else {
+		key |= uint64_t(p.start & 0xffffff);
+	}
+	return key;
+}
+
+//can objects 'a' and 'b' (at their selected levels of detail) be drawn with a single instanced draw call?
+static inline bool can_instance_together(Scene::Object const &a, RenderQueue::PreparedObject const &pa, Scene::Object const &b, RenderQueue::PreparedObject const &pb) {
+	return a.instanced_program != 0 && a.material == b.material
+		&& a.program == b.program && a.vao == b.vao && pa.start == pb.start && pa.count == pb.count
+		&& a.instanced_program == b.instanced_program && a.instanced_vao == b.instanced_vao;
+}
+
+//pick a level of detail for an object whose projected size is 'size', starting from the level it was last drawn at:
+static inline uint32_t select_lod(Scene::Object const &object, float size, float hysteresis) {
+	uint32_t level = std::min(object.lod_level, uint32_t(object.lods.size()));
+	//coarser, if small enough:
+	while (level < object.lods.size() && size < object.lods[level].screen_size * (1.0f - hysteresis)) {
+		++level;
+	}
+	//finer, if large enough:
+	while (level > 0 && size > object.lods[level-1].screen_size * (1.0f + hysteresis)) {
+		--level;
+	}
+	return level;
+}
+
+//stable LSD radix sort on QueueEntry::key, 8 bits at a time:
+// (passes where every key has the same digit are skipped)
+static void radix_sort(std::vector< RenderQueue::QueueEntry > &entries, std::vector< RenderQueue::QueueEntry > &scratch) {
+	scratch.resize(entries.size());
+	for (uint32_t shift = 0; shift < 64; shift += 8) {
+		uint32_t counts[256] = { 0 };
+		for (auto const &e : entries) {
+			counts[(e.key >> shift) & 0xff] += 1;
+		}
+		if (counts[(entries[0].key >> shift) & 0xff] == entries.size()) continue;
+		uint32_t offsets[256];
+		uint32_t total = 0;
+		for (uint32_t d = 0; d < 256; ++d) {
+			offsets[d] = total;
+			total += counts[d];
+		}
+		for (auto const &e : entries) {
+			scratch[offsets[(e.key >> shift) & 0xff]++] = e;
+		}
+		entries.swap(scratch);
+	}
+}
+
+void RenderQueue::draw(FramePacket const &packet, float aspect, Scene::DrawStats *stats) {
+	//(everything below reads matrices from the packet, never from transforms)
+	std::vector< Scene const * > const &scenes = packet.scenes;
+	std::vector< Scene::Object const * > const &objects = packet.objects;
+	std::vector< uint32_t > const &object_scenes = packet.object_scenes;
+
+	glm::mat4 world_to_clip = packet.make_projection(aspect) * packet.world_to_camera;
+	//(a sphere of radius r at view depth d has a projected diameter of about r * lod_scale / d viewport heights)
+	float lod_scale = 1.0f / std::tan(0.5f * packet.fovy);
+
+	//prepare phase (CPU only):
+	// compute matrices and cull, spread across worker threads for large queues:
+	prepared.resize(objects.size());
+	auto prepare = [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			Scene::Object const &object = *objects[i];
+			glm::mat4 const &local_to_world = packet.local_to_world[i];
+			PreparedObject &p = prepared[i];
+			p.occlusion = PreparedObject::NotTested;
+
+			//compute modelview+projection (object space to clip space) matrix for this object:
+			p.mvp = world_to_clip * local_to_world;
+
+			//skip objects whose bounding box is outside the view frustum:
+			p.visible = !(object.bbox_min.x <= object.bbox_max.x && bbox_outside_clip(p.mvp, object.bbox_min, object.bbox_max));
+			if (!p.visible) continue;
+
+			//NOTE: inverse cancels out transpose unless there is scale involved
+			p.itmv = glm::inverse(glm::transpose(glm::mat3(local_to_world)));
+
+			//view depth (i.e., clip w) of the bounding box center, for front-to-back sorting:
+			glm::vec3 center = glm::vec3(0.0f);
+			if (object.bbox_min.x <= object.bbox_max.x) center = 0.5f * (object.bbox_min + object.bbox_max);
+			p.depth = p.mvp[0][3] * center.x + p.mvp[1][3] * center.y + p.mvp[2][3] * center.z + p.mvp[3][3];
+
+			//level of detail from projected size:
+			p.lod = 0;
+			p.start = object.start;
+			p.count = object.count;
+			if (!object.lods.empty()) {
+				float scale = std::max(glm::length(glm::vec3(local_to_world[0])), std::max(glm::length(glm::vec3(local_to_world[1])), glm::length(glm::vec3(local_to_world[2]))));
+				float radius = 0.5f * glm::length(object.bbox_max - object.bbox_min) * scale;
+				float size = (p.depth > radius ? radius * lod_scale / p.depth : 1.0f);
+				p.lod = select_lod(object, size, lod_hysteresis);
+				object.lod_level = p.lod;
+				if (p.lod > 0) {
+					p.start = object.lods[p.lod-1].start;
+					p.count = object.lods[p.lod-1].count;
+				}
+			}
+		}
+	};
+	if (objects.size() >= PrepareParallelThreshold) {
+		WorkerPool::get().parallel_for(uint32_t(objects.size()), PrepareGrain, prepare);
+	} else {
+		prepare(0, uint32_t(objects.size()));
+	}
+
+	//occlusion culling: draw occluders that survived frustum culling, then test everything else against them:
+	if (occlusion_culling) {
+		occlusion_buffer.clear();
+		for (uint32_t i = 0; i < objects.size(); ++i) {
+			if (prepared[i].visible && objects[i]->occluder) {
+				occlusion_buffer.add_occluder(prepared[i].mvp, *objects[i]->occluder);
+			}
+		}
+		if (stats) stats->occluder_triangles += uint32_t(occlusion_buffer.vertices.size() / 3);
+
+		if (!occlusion_buffer.vertices.empty()) {
+			occlusion_buffer.rasterize();
+
+			auto test = [&](uint32_t begin, uint32_t end) {
+				for (uint32_t i = begin; i < end; ++i) {
+					Scene::Object const &object = *objects[i];
+					PreparedObject &p = prepared[i];
+					if (!p.visible || object.occluder || !(object.bbox_min.x <= object.bbox_max.x)) continue;
+					if (object.occlusion_hold > 0) {
+						object.occlusion_hold -= 1;
+						p.occlusion = PreparedObject::Held;
+					} else if (occlusion_buffer.is_box_occluded(p.mvp, object.bbox_min, object.bbox_max)) {
+						p.occlusion = PreparedObject::Occluded;
+						p.visible = false;
+					} else {
+						object.occlusion_hold = OcclusionHoldFrames;
+						p.occlusion = PreparedObject::Passed;
+					}
+				}
+			};
+			if (objects.size() >= PrepareParallelThreshold) {
+				WorkerPool::get().parallel_for(uint32_t(objects.size()), PrepareGrain, test);
+			} else {
+				test(0, uint32_t(objects.size()));
+			}
+		}
+	}
+
+	//build render queue from objects that survive culling:
+	queue.clear();
+	for (uint32_t i = 0; i < objects.size(); ++i) {
+		if (stats) {
+			if (prepared[i].occlusion == PreparedObject::Held) stats->occlusion_tests_held += 1;
+			if (prepared[i].occlusion == PreparedObject::Passed) stats->occlusion_tests += 1;
+			if (prepared[i].occlusion == PreparedObject::Occluded) {
+				stats->occlusion_tests += 1;
+				stats->objects_occluded += 1;
+			}
+		}
+		if (!prepared[i].visible) {
+			if (prepared[i].occlusion != PreparedObject::Occluded && stats) stats->objects_culled += 1;
+			continue;
+		}
+		QueueEntry entry;
+		entry.key = make_sort_key(*objects[i], prepared[i], sort_front_to_back);
+		entry.index = i;
+		queue.emplace_back(entry);
+	}
+	if (queue.empty()) return;
+
+	radix_sort(queue, queue_scratch);
+
+	//split queue into batches, gathering instance data for runs of the same mesh:
+	batches.clear();
+	instance_data.clear();
+	for (uint32_t begin = 0; begin < queue.size(); /* later */) {
+		Scene::Object const &object = *objects[queue[begin].index];
+		PreparedObject const &p = prepared[queue[begin].index];
+		uint32_t end = begin + 1;
+		while (end < queue.size() && can_instance_together(object, p, *objects[queue[end].index], prepared[queue[end].index])) ++end;
+
+		if (end - begin >= InstancingThreshold) {
+			batches.emplace_back(Batch{begin, end, uint32_t(instance_data.size() / 6)});
+			for (uint32_t i = begin; i < end; ++i) {
+				glm::mat4 mv = with_position_decode(packet.local_to_world[queue[i].index], *objects[queue[i].index]);
+				glm::mat3 const &itmv = prepared[queue[i].index].itmv;
+				//rows of object-to-light:
+				instance_data.emplace_back(mv[0][0], mv[1][0], mv[2][0], mv[3][0]);
+				instance_data.emplace_back(mv[0][1], mv[1][1], mv[2][1], mv[3][1]);
+				instance_data.emplace_back(mv[0][2], mv[1][2], mv[2][2], mv[3][2]);
+				//columns of normal-to-light:
+				instance_data.emplace_back(itmv[0], 0.0f);
+				instance_data.emplace_back(itmv[1], 0.0f);
+				instance_data.emplace_back(itmv[2], 0.0f);
+			}
+		} else {
+			//not enough copies to bother; draw each object in the run individually:
+			for (uint32_t i = begin; i < end; ++i) {
+				batches.emplace_back(Batch{i, i + 1, -1U});
+			}
+		}
+		begin = end;
+	}
+
+	//upload instance data:
+	if (!instance_data.empty()) {
+		if (instance_buffer == 0) {
+			glGenBuffers(1, &instance_buffer);
+			glGenTextures(1, &instance_texture);
+			glBindTexture(GL_TEXTURE_BUFFER, instance_texture);
+			glBindBuffer(GL_TEXTURE_BUFFER, instance_buffer);
+			glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instance_buffer);
+			glBindBuffer(GL_TEXTURE_BUFFER, 0);
+			glBindTexture(GL_TEXTURE_BUFFER, 0);
+		}
+		glBindBuffer(GL_TEXTURE_BUFFER, instance_buffer);
+		glBufferData(GL_TEXTURE_BUFFER, instance_data.size() * sizeof(glm::vec4), instance_data.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+
+	//write per-object matrices for programs with an ObjectBlock (into each scene's own ring):
+	scene_uses_object_blocks.assign(scenes.size(), false);
+	for (auto const &batch : batches) {
+		uint32_t index = queue[batch.begin].index;
+		if (batch.instance_base == -1U && objects[index]->program_object_block != -1U) {
+			scene_uses_object_blocks[object_scenes[index]] = true;
+		}
+	}
+	for (uint32_t s = 0; s < scenes.size(); ++s) {
+		if (!scene_uses_object_blocks[s]) continue;
+		Scene::ObjectBlockRing &ring = scenes[s]->object_block_ring;
+		if (ring.stride == 0) {
+			GLint alignment = 0;
+			glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+			alignment = std::max(alignment, 1);
+			ring.stride = uint32_t((sizeof(Scene::ObjectBlock) + alignment - 1) / alignment * alignment);
+			glGenBuffers(Scene::ObjectBlockRingSize, ring.buffers);
+		}
+
+		//advance to the next buffer in the ring:
+		// (glBufferSubData is ordered after earlier draws that read the buffer, so no fence is needed;
+		//  rotating just makes it less likely the driver has to stall or copy to make that so)
+		ring.current = (ring.current + 1) % Scene::ObjectBlockRingSize;
+
+		//hand out slots to objects that don't have them yet:
+		for (auto const &batch : batches) {
+			uint32_t index = queue[batch.begin].index;
+			Scene::Object const &object = *objects[index];
+			if (batch.instance_base != -1U || object.program_object_block == -1U || object_scenes[index] != s) continue;
+			if (object.object_block_slot != -1U) continue;
+			if (!ring.free_slots.empty()) {
+				object.object_block_slot = ring.free_slots.back();
+				ring.free_slots.pop_back();
+			} else {
+				object.object_block_slot = ring.used++;
+			}
+		}
+
+		//grow buffers if needed (everything will be rewritten):
+		if (ring.used > ring.capacity) {
+			ring.capacity = std::max(ring.used, 2 * ring.capacity);
+			ring.staging.resize(ring.capacity * ring.stride);
+			for (uint32_t i = 0; i < Scene::ObjectBlockRingSize; ++i) {
+				glBindBuffer(GL_UNIFORM_BUFFER, ring.buffers[i]);
+				glBufferData(GL_UNIFORM_BUFFER, ring.capacity * ring.stride, nullptr, GL_DYNAMIC_DRAW);
+				ring.stamps[i].assign(ring.capacity, 0);
+			}
+		}
+
+		//update slots whose transform has changed since this buffer was last filled:
+		std::vector< uint32_t > &stamps = ring.stamps[ring.current];
+		uint32_t dirty_begin = ring.capacity;
+		uint32_t dirty_end = 0;
+		for (auto const &batch : batches) {
+			uint32_t index = queue[batch.begin].index;
+			Scene::Object const &object = *objects[index];
+			if (batch.instance_base != -1U || object.program_object_block == -1U || object_scenes[index] != s) continue;
+
+			uint32_t slot = object.object_block_slot;
+			if (stamps[slot] == packet.local_to_world_stamps[index]) {
+				if (stats) stats->object_blocks_reused += 1;
+				continue;
+			}
+			stamps[slot] = packet.local_to_world_stamps[index];
+			if (stats) stats->object_blocks_written += 1;
+
+			Scene::ObjectBlock *block = reinterpret_cast< Scene::ObjectBlock * >(&ring.staging[slot * ring.stride]);
+			block->object_to_light = with_position_decode(packet.local_to_world[index], object);
+			glm::mat3 const &itmv = prepared[index].itmv;
+			block->normal_to_light[0] = glm::vec4(itmv[0], 0.0f);
+			block->normal_to_light[1] = glm::vec4(itmv[1], 0.0f);
+			block->normal_to_light[2] = glm::vec4(itmv[2], 0.0f);
+
+			dirty_begin = std::min(dirty_begin, slot);
+			dirty_end = std::max(dirty_end, slot + 1);
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, ring.buffers[ring.current]);
+		if (dirty_begin < dirty_end) {
+			glBufferSubData(GL_UNIFORM_BUFFER,
+				dirty_begin * ring.stride,
+				(dirty_end - dirty_begin) * ring.stride,
+				&ring.staging[dirty_begin * ring.stride]);
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	//depth pre-pass: lay down depth front-to-back with a cheap program, so the color pass shades each pixel about once:
+	bool did_prepass = false;
+	if (depth_program != 0) {
+		prepass_queue.clear();
+		for (auto const &entry : queue) {
+			Scene::Object const &object = *objects[entry.index];
+			if (object.depth_vao == 0 || (object.material && !object.material->depth_write)) continue;
+			QueueEntry e;
+			e.key = (uint64_t(depth_bits(prepared[entry.index].depth)) << 32) | uint64_t(object.depth_vao);
+			e.index = entry.index;
+			prepass_queue.emplace_back(e);
+		}
+		if (!prepass_queue.empty()) {
+			radix_sort(prepass_queue, queue_scratch);
+			GLState::use_program(depth_program);
+			if (depth_program_world_to_clip_mat4 != -1U) {
+				glUniformMatrix4fv(depth_program_world_to_clip_mat4, 1, GL_FALSE, glm::value_ptr(world_to_clip));
+			}
+			GLState::color_mask(false);
+			for (auto const &entry : prepass_queue) {
+				Scene::Object const &object = *objects[entry.index];
+				GLState::bind_vertex_array(object.depth_vao);
+				if (depth_program_object_to_light_mat4x3 != -1U) {
+					glm::mat4x3 object_to_light = glm::mat4x3(with_position_decode(packet.local_to_world[entry.index], object));
+					glUniformMatrix4x3fv(depth_program_object_to_light_mat4x3, 1, GL_FALSE, glm::value_ptr(object_to_light));
+				}
+				draw_triangles(object.index_type, prepared[entry.index].start, prepared[entry.index].count);
+				if (stats) stats->prepass_draw_calls += 1;
+			}
+			GLState::color_mask(true);
+			//color pass only needs to shade fragments that match the pre-pass depth:
+			GLState::depth_func(GL_LEQUAL);
+			did_prepass = true;
+		}
+	}
+
+	//count samples shaded by the color pass:
+	if (measure_overdraw) {
+		samples_query_current = (samples_query_current + 1) % SamplesQueryRingSize;
+		GLuint &query = samples_queries[samples_query_current];
+		if (query == 0) {
+			glGenQueries(1, &query);
+		} else if (samples_query_pending[samples_query_current]) {
+			//this query was issued SamplesQueryRingSize frames ago, so it is almost certainly done:
+			GLuint result = 0;
+			glGetQueryObjectuiv(query, GL_QUERY_RESULT, &result);
+			samples_shaded = result;
+		}
+		glBeginQuery(GL_SAMPLES_PASSED, query);
+		samples_query_pending[samples_query_current] = true;
+	}
+	if (stats) stats->samples_shaded += samples_shaded;
+
+	//submit batches, skipping redundant binds:
+	GLuint bound_program = 0;
+	GLuint bound_vao = 0;
+	Material const *bound_material = nullptr;
+	bool first = true;
+	auto bind = [&](GLuint program, GLuint vao, Material const *material) {
+		bool program_changed = (first || program != bound_program);
+		if (program_changed) {
+			GLState::use_program(program);
+			bound_program = program;
+			if (stats) stats->program_binds += 1;
+		} else {
+			if (stats) stats->program_binds_skipped += 1;
+		}
+		//(uniform values belong to the program, so a new program needs the material's uniforms again)
+		if (program_changed || material != bound_material) {
+			if (material) {
+				material->apply_uniforms(program);
+				if (stats) stats->material_binds += 1;
+			}
+			bound_material = material;
+			GLState::depth_mask(material ? material->depth_write : true);
+			if (material && material->cull_back_faces) GLState::enable(GL_CULL_FACE);
+			else GLState::disable(GL_CULL_FACE);
+		} else {
+			if (stats && material) stats->material_binds_skipped += 1;
+		}
+		if (first || vao != bound_vao) {
+			GLState::bind_vertex_array(vao);
+			bound_vao = vao;
+			if (stats) stats->vao_binds += 1;
+		} else {
+			if (stats) stats->vao_binds_skipped += 1;
+		}
+		first = false;
+	};
+
+	bool bound_instance_texture = false;
+	for (auto const &batch : batches) {
+		Scene::Object const &object = *objects[queue[batch.begin].index];
+		PreparedObject const &p = prepared[queue[batch.begin].index];
+		if (stats) {
+			stats->triangles_drawn += (p.count / 3) * (batch.end - batch.begin);
+			for (uint32_t i = batch.begin; i < batch.end; ++i) {
+				if (prepared[queue[i].index].lod > 0) stats->objects_lod_reduced += 1;
+			}
+		}
+
+		if (batch.instance_base != -1U) {
+			//draw all objects in the batch with one call:
+			bind(object.instanced_program, object.instanced_vao, object.material);
+			if (!bound_instance_texture) {
+				glActiveTexture(GL_TEXTURE0);
+				glBindTexture(GL_TEXTURE_BUFFER, instance_texture);
+				bound_instance_texture = true;
+			}
+			if (object.instanced_program_world_to_clip_mat4 != -1U) {
+				glUniformMatrix4fv(object.instanced_program_world_to_clip_mat4, 1, GL_FALSE, glm::value_ptr(world_to_clip));
+			}
+			if (object.instanced_program_instance_data_samplerBuffer != -1U) {
+				glUniform1i(object.instanced_program_instance_data_samplerBuffer, 0);
+			}
+			if (object.instanced_program_instance_base_int != -1U) {
+				glUniform1i(object.instanced_program_instance_base_int, GLint(batch.instance_base));
+			}
+			draw_triangles(object.index_type, p.start, p.count, batch.end - batch.begin);
+			if (stats) {
+				stats->draw_calls += 1;
+				stats->objects_drawn += batch.end - batch.begin;
+				stats->objects_instanced += batch.end - batch.begin;
+			}
+			continue;
+		}
+
+		if (object.program_object_block != -1U) {
+			//matrices come from this object's slot in its scene's object block ring:
+			Scene::ObjectBlockRing const &ring = scenes[object_scenes[queue[batch.begin].index]]->object_block_ring;
+			bind(object.program, object.vao, object.material);
+			if (object.program_world_to_clip_mat4 != -1U) {
+				glUniformMatrix4fv(object.program_world_to_clip_mat4, 1, GL_FALSE, glm::value_ptr(world_to_clip));
+			}
+			glBindBufferRange(GL_UNIFORM_BUFFER, Scene::ObjectBlockBinding, ring.buffers[ring.current],
+				object.object_block_slot * ring.stride, sizeof(Scene::ObjectBlock));
+
+			draw_triangles(object.index_type, p.start, p.count);
+			if (stats) {
+				stats->draw_calls += 1;
+				stats->objects_drawn += 1;
+			}
+			continue;
+		}
+
+		//matrices from the prepare phase:
+		glm::mat4 mvp = with_position_decode(p.mvp, object);
+		glm::mat4 mv = with_position_decode(packet.local_to_world[queue[batch.begin].index], object);
+		glm::mat3 const &itmv = p.itmv;
+
+		//set up program uniforms:
+		bind(object.program, object.vao, object.material);
+		if (object.program_mvp_mat4 != -1U) {
+			glUniformMatrix4fv(object.program_mvp_mat4, 1, GL_FALSE, glm::value_ptr(mvp));
+		}
+		if (object.program_mv_mat4x3 != -1U) {
+			glUniformMatrix4x3fv(object.program_mv_mat4x3, 1, GL_FALSE, glm::value_ptr(mv));
+		}
+		if (object.program_itmv_mat3 != -1U) {
+			glUniformMatrix3fv(object.program_itmv_mat3, 1, GL_FALSE, glm::value_ptr(itmv));
+		}
+
+		//draw the object:
+		draw_triangles(object.index_type, p.start, p.count);
+		if (stats) {
+			stats->draw_calls += 1;
+			stats->objects_drawn += 1;
+		}
+	}
+
+	if (bound_instance_texture) {
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+	}
+	//restore default render state:
+	GLState::depth_mask(true);
+	GLState::disable(GL_CULL_FACE);
+
+	if (measure_overdraw) {
+		glEndQuery(GL_SAMPLES_PASSED);
+	}
+	if (did_prepass) {
+		GLState::depth_func(GL_LESS);
+	}
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "Scene.hpp"
+#include "GL.hpp"
+#include "OcclusionBuffer.hpp"
+#include "FramePacket.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+//"RenderQueue" draws the objects of any number of Scenes together:
+//
+//  queue.clear();
+//  queue.add(world_scene);
+//  queue.add(player_scene);
+//  queue.draw(camera, &stats);
+//
+// Per-camera matrices are computed once, and all objects are culled and sorted
+// by state (program, material, vao) as a group, so binds can be shared across scenes.
+// (Scene::draw is shorthand for a queue containing a single scene.)
+//
+// Objects are referenced (not copied) by add, so scenes must not delete objects
+// between add and draw; their world matrices, however, are copied by add.
+// (add fills a FramePacket -- see FramePacket.hpp -- and a queue can also draw a packet
+//  captured elsewhere, which lets drawing run while scenes are updated for the next frame)
+
+struct RenderQueue {
+	RenderQueue() = default;
+	RenderQueue(RenderQueue const &) = delete;
+	RenderQueue &operator=(RenderQueue const &) = delete;
+	~RenderQueue(); //frees instance buffer and queries
+
+	//remove all objects from the queue:
+	void clear();
+
+	//add every object in 'scene' to the queue (each scene should be added at most once):
+	void add(Scene const &scene);
+
+	//cull, sort, and draw queued objects from a given camera:
+	//"camera" must be non-null!
+	//"stats", if non-null, will be updated with counts of what was drawn
+	void draw(Scene::Camera const *camera, Scene::DrawStats *stats = nullptr);
+
+	//cull, sort, and draw the objects in 'packet' from its camera (ignores clear/add):
+	//"aspect" is that of the framebuffer being drawn to (x / y)
+	// (objects in the packet are drawn with the matrices it captured, not their transforms' current ones)
+	void draw(FramePacket const &packet, float aspect, Scene::DrawStats *stats = nullptr);
+
+	//------ options ------
+
+	//order objects that can't be instanced front-to-back (within each program/vao group), reducing overdraw:
+	bool sort_front_to_back = true;
+
+	//depth pre-pass (off unless depth_program is set):
+	// visible objects with a depth_vao are drawn front-to-back, depth only, with this program (e.g., depth_program.hpp);
+	// the color pass then draws with GL_LEQUAL, so expensive fragment shaders run about once per pixel.
+	GLuint depth_program = 0;
+	GLuint depth_program_world_to_clip_mat4 = -1U;
+	GLuint depth_program_object_to_light_mat4x3 = -1U;
+
+	//measure samples shaded by the color pass with GL_SAMPLES_PASSED queries (reported in DrawStats::samples_shaded):
+	// results are read back SamplesQueryRingSize frames later, to avoid stalling on the GPU.
+	// (samples_shaded / pixels in the framebuffer gives average overdraw)
+	bool measure_overdraw = false;
+
+	//occlusion culling:
+	// visible objects with an occluder are drawn into occlusion_buffer, then other objects are
+	// tested against it. An object found visible skips the test for the next OcclusionHoldFrames
+	// draws, which spreads out the cost of testing and keeps objects near silhouettes from flickering.
+	bool occlusion_culling = false;
+	OcclusionBuffer occlusion_buffer;
+	enum : uint32_t { OcclusionHoldFrames = 4 };
+
+	//level of detail selection (see Scene::Object::lods):
+	// an object moves to a coarser level once its size falls below (1 - lod_hysteresis) times that
+	// level's screen_size, and back once it grows past (1 + lod_hysteresis) times, so it doesn't flicker
+	// between levels near a threshold.
+	float lod_hysteresis = 0.1f;
+
+	//------ internals ------
+
+	//queued objects (filled by clear/add, captured and drawn by draw(camera)):
+	FramePacket packet;
+
+	//per-object results of draw's prepare phase (parallel to the packet's objects):
+	// computed on worker threads (see WorkerPool.hpp) when the queue is large enough to benefit
+	struct PreparedObject {
+		glm::mat4 mvp; //object to clip space
+		glm::mat3 itmv; //normal to light space (only computed if visible)
+		bool visible; //survived frustum culling
+		float depth; //view depth of bounding box center (only computed if visible)
+		enum : uint8_t { NotTested, Held, Passed, Occluded } occlusion; //result of occlusion culling
+		uint32_t lod; //selected level of detail (0 = the object's own mesh; only computed if visible)
+		GLuint start, count; //mesh range for that level
+	};
+	std::vector< PreparedObject > prepared;
+	enum : uint32_t {
+		PrepareParallelThreshold = 1024, //minimum objects to use worker threads
+		PrepareGrain = 256, //objects per worker task
+	};
+
+	//objects that survive culling are sorted by state (program, material, vao) so that binds can be shared:
+	struct QueueEntry {
+		uint64_t key; //sort key (see make_sort_key in RenderQueue.cpp)
+		uint32_t index; //into the packet's objects / prepared
+	};
+	//(kept between frames to avoid reallocating)
+	std::vector< QueueEntry > queue, queue_scratch;
+	std::vector< QueueEntry > prepass_queue; //objects drawn in the depth pre-pass, keyed by depth
+
+	//instanced drawing:
+	struct Batch {
+		uint32_t begin, end; //range of entries in queue
+		uint32_t instance_base; //offset in instance_data (in instances), or -1U for non-instanced
+	};
+	std::vector< Batch > batches;
+	std::vector< glm::vec4 > instance_data; //per-instance data, uploaded to instance_buffer
+	GLuint instance_buffer = 0; //created on first use
+	GLuint instance_texture = 0; //buffer texture over instance_buffer
+	enum : uint32_t { InstancingThreshold = 2 }; //minimum objects sharing a mesh to draw instanced
+
+	//which scenes' object block rings (see Scene::ObjectBlockRing) are used by the current draw:
+	std::vector< bool > scene_uses_object_blocks;
+
+	//overdraw measurement:
+	enum : uint32_t { SamplesQueryRingSize = 4 };
+	GLuint samples_queries[SamplesQueryRingSize] = {0, 0, 0, 0};
+	bool samples_query_pending[SamplesQueryRingSize] = {false, false, false, false};
+	uint32_t samples_query_current = 0;
+	uint32_t samples_shaded = 0; //most recent result
+};
@@ -1,10 +1,14 @@
 #include "Scene.hpp"
 #include "read_chunk.hpp"
+#include "RenderQueue.hpp"
+#include "SceneBVH.hpp"
+#include "TriangleBVH.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
+#include <algorithm>
 #include <fstream>
 
 glm::mat4 Scene::Transform::make_local_to_parent() const {
@@ -59,6 +63,44 @@ glm::mat4 Scene::Transform::make_world_to_local() const {
 	}
 }
 
+uint32_t Scene::Transform::next_stamp = 1; //(0 means 'never computed')
+
+glm::mat4 const &Scene::Transform::get_local_to_world() const {
+	if (local_to_world_dirty) {
+		if (parent) {
+			local_to_world_cache = parent->get_local_to_world() * make_local_to_parent();
+		} else {
+			local_to_world_cache = make_local_to_parent();
+		}
+		local_to_world_dirty = false;
+		local_to_world_stamp = next_stamp++;
+		if (next_stamp == 0) next_stamp = 1;
+	}
+	return local_to_world_cache;
+}
+
+glm::mat4 const &Scene::Transform::get_world_to_local() const {
+	if (world_to_local_dirty) {
+		if (parent) {
+			world_to_local_cache = make_parent_to_local() * parent->get_world_to_local();
+		} else {
+			world_to_local_cache = make_parent_to_local();
+		}
+		world_to_local_dirty = false;
+	}
+	return world_to_local_cache;
+}
+
+void Scene::Transform::mark_dirty() {
+	//a dirty transform's descendants are already dirty, so there is no need to descend further:
+	if (local_to_world_dirty && world_to_local_dirty) return;
+	local_to_world_dirty = true;
+	world_to_local_dirty = true;
+	for (Transform *child = last_child; child != nullptr; child = child->prev_sibling) {
+		child->mark_dirty();
+	}
+}
+
 void Scene::Transform::DEBUG_assert_valid_pointers() const {
 	if (parent == nullptr) {
 		//if no parent, can't have siblings:
@@ -98,6 +140,7 @@ void Scene::Transform::set_parent(Transform *new_parent, Transform *before) {
 		}
 		if (prev_sibling) prev_sibling->next_sibling = this;
 	}
+	mark_dirty(); //world matrices depend on parent
 	DEBUG_assert_valid_pointers();
 }
 
@@ -109,107 +152,152 @@ glm::mat4 Scene::Camera::make_projection() const {
 
 //---------------------------
 
-//templated helper functions to avoid having to write the same new/delete code three times:
-template< typename T, typename... Args >
-T *list_new(T * &first, Args&&... args) {
-	T *t = new T(std::forward< Args >(args)...); //"perfect forwarding"
-	if (first) {
-		t->alloc_next = first;
-		first->alloc_prev_next = &t->alloc_next;
-	}
-	t->alloc_prev_next = &first;
-	first = t;
-	return t;
-}
-
-template< typename T >
-void list_delete(T * t) {
-	assert(t && "It is invalid to delete a null scene object [yes this is different than 'delete']");
-	assert(t->alloc_prev_next);
-	if (t->alloc_next) {
-		t->alloc_next->alloc_prev_next = t->alloc_prev_next;
-	}
-	*t->alloc_prev_next = t->alloc_next;
-	//PARANOIA:
-	t->alloc_next = nullptr;
-	t->alloc_prev_next = nullptr;
-}
-
 Scene::Transform *Scene::new_transform() {
-	return list_new< Scene::Transform >(first_transform);
+	return transforms.new_item();
 }
 
 void Scene::delete_transform(Scene::Transform *transform) {
-	list_delete< Scene::Transform >(transform);
+	if (!transform->name.empty()) {
+		//remove from name indices (same-named transforms are adjacent in sorted order):
+		auto range = std::equal_range(transforms_sorted_by_name.begin(), transforms_sorted_by_name.end(), transform,
+			[](Scene::Transform const *a, Scene::Transform const *b){
+				return a->name < b->name;
+			});
+		size_t first = range.first - transforms_sorted_by_name.begin();
+		size_t count = range.second - range.first;
+		auto s = std::find(range.first, range.second, transform);
+		if (s != range.second) {
+			transforms_sorted_by_name.erase(s);
+			count -= 1;
+		}
+		auto f = transforms_by_name.find(transform->name);
+		if (f != transforms_by_name.end() && f->second == transform) {
+			//point at another transform with the same name, if any:
+			if (count > 0) f->second = transforms_sorted_by_name[first];
+			else transforms_by_name.erase(f);
+		}
+	}
+	transforms.delete_item(transform);
 }
 
 Scene::Object *Scene::new_object(Scene::Transform *transform) {
 	assert(transform && "Scene::Object must be attached to a transform.");
-	return list_new< Scene::Object >(first_object, transform);
+	return objects.new_item(transform);
 }
 
 void Scene::delete_object(Scene::Object *object) {
-	list_delete< Scene::Object >(object);
+	if (object->object_block_slot != -1U) {
+		//release slot in the object block ring:
+		for (auto &stamps : object_block_ring.stamps) {
+			stamps[object->object_block_slot] = 0;
+		}
+		object_block_ring.free_slots.emplace_back(object->object_block_slot);
+	}
+	objects.delete_item(object);
 }
 
 Scene::Camera *Scene::new_camera(Scene::Transform *transform) {
 	assert(transform && "Scene::Camera must be attached to a transform.");
-	return list_new< Scene::Camera >(first_camera, transform);
+	return cameras.new_item(transform);
 }
 
-void Scene::delete_camera(Scene::Camera *object) {
-	list_delete< Scene::Camera >(object);
+void Scene::delete_camera(Scene::Camera *camera) {
+	cameras.delete_item(camera);
 }
 
-void Scene::draw(Scene::Camera const *camera) const {
-	assert(camera && "Must have a camera to draw scene from.");
-
-	glm::mat4 world_to_camera = camera->transform->make_world_to_local();
-	glm::mat4 world_to_clip = camera->make_projection() * world_to_camera;
-
-	for (Scene::Object *object = first_object; object != nullptr; object = object->alloc_next) {
-		glm::mat4 local_to_world = object->transform->make_local_to_world();
+void Scene::index_names() {
+	transforms_by_name.clear();
+	transforms_sorted_by_name.clear();
+	for (Scene::Transform &transform : transforms) {
+		if (transform.name.empty()) continue;
+		transforms_by_name.emplace(transform.name, &transform); //(keeps the first if names repeat)
+		transforms_sorted_by_name.emplace_back(&transform);
+	}
+	std::sort(transforms_sorted_by_name.begin(), transforms_sorted_by_name.end(), [](Scene::Transform const *a, Scene::Transform const *b){
+		return a->name < b->name;
+	});
+}
 
-		//compute modelview+projection (object space to clip space) matrix for this object:
-		glm::mat4 mvp = world_to_clip * local_to_world;
+Scene::Transform *Scene::find_transform(std::string const &name) const {
+	auto f = transforms_by_name.find(name);
+	if (f == transforms_by_name.end()) return nullptr;
+	return f->second;
+}
 
-		//compute modelview (object space to camera local space) matrix for this object:
-		glm::mat4 mv = local_to_world;
+std::vector< Scene::Transform * > Scene::find_transforms_with_prefix(std::string const &prefix) const {
+	//names starting with 'prefix' form a contiguous run in sorted order, beginning at the first name >= prefix:
+	auto begin = std::lower_bound(transforms_sorted_by_name.begin(), transforms_sorted_by_name.end(), prefix, [](Scene::Transform const *t, std::string const &p){
+		return t->name < p;
+	});
+	auto end = begin;
+	while (end != transforms_sorted_by_name.end() && (*end)->name.compare(0, prefix.size(), prefix) == 0) {
+		++end;
+	}
+	return std::vector< Scene::Transform * >(begin, end);
+}
 
-		//NOTE: inverse cancels out transpose unless there is scale involved
-		glm::mat3 itmv = glm::inverse(glm::transpose(glm::mat3(mv)));
+void Scene::draw(Scene::Camera const *camera, Scene::DrawStats *stats) const {
+	if (!render_queue) render_queue.reset(new RenderQueue());
+	render_queue->clear();
+	render_queue->add(*this);
+	render_queue->draw(camera, stats);
+}
 
-		//set up program uniforms:
-		glUseProgram(object->program);
-		if (object->program_mvp_mat4 != -1U) {
-			glUniformMatrix4fv(object->program_mvp_mat4, 1, GL_FALSE, glm::value_ptr(mvp));
+bool Scene::raycast(glm::vec3 const &origin, glm::vec3 const &direction, float max_t, RaycastHit *hit, SceneBVH const *bvh) const {
+	Object const *found = nullptr;
+	uint32_t found_triangle = 0;
+
+	//test an object in its local space (t is the same there, since the transform is affine):
+	auto test = [&](Object const &object) {
+		if (!object.triangles) return;
+		glm::mat4 const &world_to_local = object.transform->get_world_to_local();
+		glm::vec3 local_origin = glm::vec3(world_to_local * glm::vec4(origin, 1.0f));
+		glm::vec3 local_direction = glm::mat3(world_to_local) * direction;
+		uint32_t triangle = 0;
+		if (object.triangles->raycast(local_origin, local_direction, max_t, &triangle)) {
+			found = &object;
+			found_triangle = triangle;
 		}
-		if (object->program_mv_mat4x3 != -1U) {
-			glUniformMatrix4x3fv(object->program_mv_mat4x3, 1, GL_FALSE, glm::value_ptr(mv));
+	};
+
+	if (bvh) {
+		std::vector< SceneBVH::RayHit > &candidates = bvh->ray_hits;
+		candidates.clear();
+		bvh->query_ray(origin, direction, max_t, candidates);
+		for (auto const &candidate : candidates) {
+			if (candidate.distance > max_t) break; //(everything after is farther than the current hit)
+			test(*candidate.object);
 		}
-		if (object->program_itmv_mat3 != -1U) {
-			glUniformMatrix3fv(object->program_itmv_mat3, 1, GL_FALSE, glm::value_ptr(itmv));
+	} else {
+		for (Object const &object : objects) {
+			test(object);
 		}
+	}
 
-		if (object->set_uniforms) object->set_uniforms();
-
-		glBindVertexArray(object->vao);
-
-		//draw the object:
-		glDrawArrays(GL_TRIANGLES, object->start, object->count);
+	if (!found) return false;
+	if (hit) {
+		hit->object = found;
+		hit->triangle = found_triangle;
+		hit->t = max_t;
+		hit->point = origin + max_t * direction;
 	}
+	return true;
 }
 
+Scene::Scene() {
+}
 
 Scene::~Scene() {
-	while (first_camera) {
-		delete_camera(first_camera);
-	}
-	while (first_object) {
-		delete_object(first_object);
-	}
-	while (first_transform) {
-		delete_transform(first_transform);
+	//objects and cameras refer to transforms, so free them first:
+	cameras.clear();
+	objects.clear();
+	transforms.clear();
+
+	for (uint32_t i = 0; i < ObjectBlockRingSize; ++i) {
+		if (object_block_ring.buffers[i] != 0) {
+			glDeleteBuffers(1, &object_block_ring.buffers[i]);
+			object_block_ring.buffers[i] = 0;
+		}
 	}
 }
 
@@ -270,6 +358,10 @@ void Scene::load(std::string const &filename,
 	//--------------------------------
 	//Now that file is loaded, create transforms for hierarchy entries:
 
+	//allocate the whole hierarchy (and, likely, its objects) in contiguous runs:
+	transforms.reserve(uint32_t(hierarchy.size()));
+	objects.reserve(uint32_t(meshes.size()));
+
 	std::vector< Transform * > hierarchy_transforms;
 	hierarchy_transforms.reserve(hierarchy.size());
 
@@ -291,11 +383,15 @@ void Scene::load(std::string const &filename,
 		t->position = h.position;
 		t->rotation = h.rotation;
 		t->scale = h.scale;
+		t->mark_dirty();
 
 		hierarchy_transforms.emplace_back(t);
 	}
 	assert(hierarchy_transforms.size() == hierarchy.size());
 
+	//make new names available to find_transform* (including from on_object):
+	index_names();
+
 	for (auto const &m : meshes) {
 		if (m.transform >= hierarchy_transforms.size()) {
 			throw std::runtime_error("scene file '" + filename + "' contains mesh entry with invalid transform index (" + std::to_string(m.transform) + ")");
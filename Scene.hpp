@@ -1,15 +1,23 @@
 #pragma once
 
 #include "GL.hpp"
+#include "Pool.hpp"
+#include "Material.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
 #include <vector>
 #include <list>
+#include <unordered_map>
 #include <functional>
+#include <memory>
 #include <string>
 
+struct RenderQueue;
+struct SceneBVH;
+struct TriangleBVH;
+
 //"Scene" manages a hierarchy of transformations with, potentially, attached information.
 struct Scene {
 
@@ -21,6 +29,11 @@ struct Scene {
 		glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
 		glm::quat rotation = glm::quat(0.0f, 0.0f, 0.0f, 1.0f);
 		glm::vec3 scale = glm::vec3(1.0f, 1.0f, 1.0f);
+		//NOTE: if you write position/rotation/scale directly, call mark_dirty() afterward
+		// (or use these helpers, which do so for you):
+		void set_position(glm::vec3 const &position_) { position = position_; mark_dirty(); }
+		void set_rotation(glm::quat const &rotation_) { rotation = rotation_; mark_dirty(); }
+		void set_scale(glm::vec3 const &scale_) { scale = scale_; mark_dirty(); }
 
 		//hierarchy information:
 		Transform *parent = nullptr;
@@ -41,6 +54,14 @@ struct Scene {
 		glm::mat4 make_local_to_world() const;
 		glm::mat4 make_world_to_local() const;
 
+		//cached versions of make_local_to_world / make_world_to_local:
+		// (only recomputed when this transform or one of its ancestors is marked dirty)
+		glm::mat4 const &get_local_to_world() const;
+		glm::mat4 const &get_world_to_local() const;
+
+		//invalidate cached matrices for this transform and all of its descendants:
+		void mark_dirty();
+
 		//constructor/destructor:
 		Transform() = default;
 		Transform(Transform &) = delete;
@@ -53,9 +74,15 @@ struct Scene {
 			}
 		}
 
-		//used by Scene to manage allocation:
-		Transform **alloc_prev_next = nullptr;
-		Transform *alloc_next = nullptr;
+		//cache used by get_local_to_world / get_world_to_local:
+		// (if a transform is dirty, all of its descendants are as well)
+		mutable glm::mat4 local_to_world_cache;
+		mutable glm::mat4 world_to_local_cache;
+		mutable bool local_to_world_dirty = true;
+		mutable bool world_to_local_dirty = true;
+		//changes (to a never-before-used value) whenever local_to_world_cache is recomputed:
+		mutable uint32_t local_to_world_stamp = 0;
+		static uint32_t next_stamp;
 	};
 
 	//"Object"s contain information needed to render meshes:
@@ -70,18 +97,75 @@ struct Scene {
 		GLuint program_mvp_mat4 = -1U; //uniform index for object-to-clip matrix (mat4)
 		GLuint program_mv_mat4x3 = -1U; //uniform index for model-to-lighting-space matrix (mat4x3)
 		GLuint program_itmv_mat3 = -1U; //uniform index for normal-to-lighting-space matrix (mat3)
+		//alternatively, programs may read per-object matrices from a uniform block (see Scene::ObjectBlock):
+		GLuint program_object_block = -1U; //uniform block index of an ObjectBlock (bound to Scene::ObjectBlockBinding)
+		GLuint program_world_to_clip_mat4 = -1U; //uniform index for world-to-clip matrix (mat4), used along with the block
 
-		//material info:
-		std::function< void() > set_uniforms; //will be called before rendering object, use to set material parameters (e.g. glossiness)
+		//material info (optional; see Material.hpp):
+		// uniform values and render state, usually shared by many objects; the material's uniforms
+		// are looked up by name in 'program' (and 'instanced_program').
+		Material const *material = nullptr;
+
+		//instanced program info (optional):
+		// when several objects share program, vao, mesh, and material, they are drawn with one glDrawArraysInstanced call.
+		// the instanced program reads per-instance matrices from a buffer texture (see vertex_color_program.hpp for the layout)
+		GLuint instanced_program = 0;
+		GLuint instanced_vao = 0; //vao binding this object's mesh attributes to instanced_program
+		GLuint instanced_program_world_to_clip_mat4 = -1U;
+		GLuint instanced_program_instance_data_samplerBuffer = -1U;
+		GLuint instanced_program_instance_base_int = -1U;
 
 		//attribute info:
 		GLuint vao = 0;
 		GLuint start = 0;
 		GLuint count = 0;
+		//if set, start/count (and those of lods) are a range of indices of this type in the element
+		// buffer bound to the vaos (e.g., MeshBuffer::index_type), and are drawn with glDrawElements:
+		GLenum index_type = 0;
+		//maps the vaos' positions to object space as position_offset + position_scale * position
+		// (copied from MeshBuffer::Mesh; only quantized meshes need anything but the identity, and lods share it):
+		glm::vec3 position_offset = glm::vec3(0.0f);
+		glm::vec3 position_scale = glm::vec3(1.0f);
+		//coarser versions of the mesh (in the same vao), from finest to coarsest (optional):
+		// level i+1 (i.e., lods[i]) is drawn once the object's projected size -- the diameter of the
+		// bounding box's sphere as a fraction of viewport height -- falls below lods[i].screen_size.
+		// (see MeshBuffer::lookup_lods for finding these by name)
+		struct LOD {
+			GLuint start = 0;
+			GLuint count = 0;
+			float screen_size = 0.0f;
+		};
+		std::vector< LOD > lods;
+		//level last drawn (0 means start/count), kept so that switching levels can use hysteresis:
+		mutable uint32_t lod_level = 0;
+
+		//position-only vao for the same mesh, used by RenderQueue's depth pre-pass (objects without one are skipped):
+		// (only set this if 'program' computes gl_Position exactly as depth_program does)
+		GLuint depth_vao = 0;
+
+		//bounding box (in object space) used for view-frustum culling:
+		// (objects with an empty box -- the default -- are never culled)
+		glm::vec3 bbox_min = glm::vec3( 1.0f);
+		glm::vec3 bbox_max = glm::vec3(-1.0f);
 
-		//used by Scene to manage allocation:
-		Object **alloc_prev_next = nullptr;
-		Object *alloc_next = nullptr;
+		//set on objects that will never move, so that bake_static may merge them (see bake_static.hpp):
+		// (objects with an occluder or triangles are never baked, since those are in the object's local space;
+		//  nor are objects with lods, since chunks have a single level)
+		bool is_static = false;
+
+		//occluder for RenderQueue's occlusion culling (optional; see OcclusionBuffer.hpp):
+		// a list of object-space triangles (three vertices each), usually a simplified version of the mesh.
+		// the vector must outlive the object.
+		std::vector< glm::vec3 > const *occluder = nullptr;
+		//frames left before this object is tested for occlusion again (set when a test finds it visible):
+		mutable uint32_t occlusion_hold = 0;
+
+		//object-space triangles of the mesh, for Scene::raycast (optional; see TriangleBVH.hpp):
+		// objects without triangles can't be hit. must outlive the object.
+		TriangleBVH const *triangles = nullptr;
+
+		//used by Scene to manage this object's slot in the object block ring:
+		mutable uint32_t object_block_slot = -1U;
 	};
 
 	//"Camera"s contain information needed to view a scene:
@@ -98,10 +182,6 @@ struct Scene {
 		float near = 0.01f; //near plane
 		//computed from the above:
 		glm::mat4 make_projection() const;
-
-		//used by Scene to manage allocation:
-		Camera **alloc_prev_next = nullptr;
-		Camera *alloc_next = nullptr;
 	};
 
 	//------ functions to create / destroy scene things -----
@@ -122,20 +202,105 @@ struct Scene {
 	//Delete a camera:
 	void delete_camera(Camera *);
 
-	//used to manage allocated objects:
-	Transform *first_transform = nullptr;
-	Object *first_object = nullptr;
-	Camera *first_camera = nullptr;
-	//(you shouldn't be manipulating these pointers directly
+	//storage for allocated things:
+	// (iterate with, e.g., 'for (Scene::Object &object : scene.objects)'; use the functions above to add/remove)
+	Pool< Transform > transforms;
+	Pool< Object > objects;
+	Pool< Camera > cameras;
+
+	//------ finding transforms by name ------
+
+	//Look up a transform by its exact name (returns nullptr if there isn't one):
+	Transform *find_transform(std::string const &name) const;
+	//All transforms whose names start with 'prefix' (e.g., "Phone."), in name order:
+	std::vector< Transform * > find_transforms_with_prefix(std::string const &prefix) const;
+
+	//The index used by the functions above is rebuilt by load() and updated by delete_transform().
+	// If you rename transforms or name ones you create yourself, call index_names() afterward:
+	void index_names();
+	std::unordered_map< std::string, Transform * > transforms_by_name; //(if names repeat, one of the transforms)
+	std::vector< Transform * > transforms_sorted_by_name; //named transforms, sorted for prefix queries
+
+	//------ ray casting ------
+
+	struct RaycastHit {
+		Object const *object = nullptr;
+		uint32_t triangle = 0; //index of the triangle in the object's mesh (as given to its TriangleBVH)
+		float t = 0.0f; //the hit is at origin + t * direction
+		glm::vec3 point = glm::vec3(0.0f); //(world space)
+	};
+
+	//Find the first object (with triangles) hit by origin + t * direction, for 0 <= t <= max_t:
+	// returns false if nothing was hit.
+	// if 'bvh' (built over this scene; see SceneBVH.hpp) is given, only objects whose boxes the ray
+	// passes through are tested, nearest first; otherwise every object with triangles is.
+	// (the bvh's ray_hits holds the candidates, so a bvh may only be used by one raycast at a time)
+	bool raycast(glm::vec3 const &origin, glm::vec3 const &direction, float max_t, RaycastHit *hit, SceneBVH const *bvh = nullptr) const;
 
 	//------ functions to traverse the scene ------
 
+	//Counters filled in by draw:
+	// (draw adds to these, so the same DrawStats can be passed to several draw calls)
+	struct DrawStats {
+		uint32_t objects_drawn = 0;
+		uint32_t objects_culled = 0; //outside the view frustum
+		uint32_t program_binds = 0; //glUseProgram calls issued
+		uint32_t program_binds_skipped = 0; //...and avoided because the program was already bound
+		uint32_t material_binds = 0; //times a material's uniforms were uploaded
+		uint32_t material_binds_skipped = 0; //...and avoided because the same program and material were already bound
+		uint32_t vao_binds = 0; //glBindVertexArray calls issued
+		uint32_t vao_binds_skipped = 0; //...and avoided because the vao was already bound
+		uint32_t draw_calls = 0; //glDrawArrays* calls issued
+		uint32_t triangles_drawn = 0; //triangles submitted by the color pass
+		uint32_t objects_lod_reduced = 0; //objects drawn with one of their coarser lods
+		uint32_t objects_instanced = 0; //objects drawn as part of an instanced draw call
+		uint32_t object_blocks_written = 0; //object block slots uploaded (because their transform changed)
+		uint32_t object_blocks_reused = 0; //object block slots that were already up to date
+		uint32_t prepass_draw_calls = 0; //glDrawArrays calls issued by the depth pre-pass
+		uint32_t samples_shaded = 0; //samples that passed the depth test in the color pass, from a recent frame (see RenderQueue::measure_overdraw)
+		uint32_t occluder_triangles = 0; //triangles drawn into the occlusion buffer
+		uint32_t occlusion_tests = 0; //objects tested against the occlusion buffer
+		uint32_t occlusion_tests_held = 0; //...and not tested because they were recently found visible
+		uint32_t objects_occluded = 0; //objects skipped because they were hidden behind occluders
+	};
+
 	//Draw the scene from a given camera by computing appropriate matrices and sending all objects to OpenGL:
 	//"camera" must be non-null!
-	void draw(Camera const *camera) const;
+	//"stats", if non-null, will be updated with counts of what was drawn
+	// (to draw several scenes together, use a RenderQueue -- see RenderQueue.hpp -- instead)
+	void draw(Camera const *camera, DrawStats *stats = nullptr) const;
 
+	Scene();
 	~Scene(); //destructor deallocates transforms, objects, cameras
 
+	//queue used by draw (created on first use):
+	mutable std::unique_ptr< RenderQueue > render_queue;
+
+	//per-object matrices for programs with an ObjectBlock:
+	// Each object gets a persistent slot in its scene's ring of uniform buffers (one buffer per frame in flight).
+	// A slot is only rewritten when the object's transform has changed since that buffer was last used
+	// (buffers are updated with glBufferSubData, which the GL orders after any draws still reading them).
+	struct ObjectBlock { //matches the std140 layout of 'uniform ObjectBlock { mat4x3 object_to_light; mat3 normal_to_light; }'
+		glm::mat4 object_to_light; //(std140 pads each mat4x3 column to a vec4, so this is a mat4)
+		glm::vec4 normal_to_light[3]; //(...and each mat3 column as well)
+	};
+	static_assert(sizeof(ObjectBlock) == 4*16 + 3*16, "ObjectBlock is packed as std140.");
+	enum : uint32_t {
+		ObjectBlockBinding = 0, //uniform buffer binding point used for ObjectBlock
+		ObjectBlockRingSize = 3, //frames in flight
+	};
+	struct ObjectBlockRing {
+		GLuint buffers[ObjectBlockRingSize] = {0, 0, 0};
+		std::vector< uint32_t > stamps[ObjectBlockRingSize]; //transform stamp last written to each slot of each buffer
+		std::vector< uint8_t > staging; //CPU copy of every slot
+		uint32_t current = 0; //buffer being filled by the current draw (advanced by RenderQueue::draw)
+		uint32_t capacity = 0; //slots per buffer
+		uint32_t stride = 0; //bytes per slot (sizeof(ObjectBlock) rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT)
+		uint32_t used = 0; //slots ever handed out
+		std::vector< uint32_t > free_slots; //slots released by deleted objects
+	};
+	mutable ObjectBlockRing object_block_ring;
+
 	//create transforms from a scene file:
 	// the 'on_object' callback gives you a chance to look up a mesh by name and make an object.
 	void load(std::string const &filename,
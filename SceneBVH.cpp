@@ -0,0 +1,159 @@
+#include "SceneBVH.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+void SceneBVH::update_item(Item &item) {
+	Scene::Object const &object = *item.object;
+	glm::mat4 const &local_to_world = object.transform->get_local_to_world();
+	item.stamp = object.transform->local_to_world_stamp;
+
+	if (!(object.bbox_min.x <= object.bbox_max.x)) {
+		//no bounding box, so use the origin:
+		item.min = item.max = glm::vec3(local_to_world[3]);
+		return;
+	}
+
+	//transform center, and grow the extent by the absolute value of each axis:
+	glm::vec3 center = glm::vec3(local_to_world * glm::vec4(0.5f * (object.bbox_min + object.bbox_max), 1.0f));
+	glm::vec3 half = 0.5f * (object.bbox_max - object.bbox_min);
+	glm::vec3 extent = glm::abs(glm::vec3(local_to_world[0])) * half.x
+	                 + glm::abs(glm::vec3(local_to_world[1])) * half.y
+	                 + glm::abs(glm::vec3(local_to_world[2])) * half.z;
+	item.min = center - extent;
+	item.max = center + extent;
+}
+
+void SceneBVH::build(Scene const &scene) {
+	items.clear();
+	for (Scene::Object const &object : scene.objects) {
+		Item item;
+		item.object = &object;
+		update_item(item);
+		items.emplace_back(item);
+	}
+	BVH::build(nodes, items, [](Item const &item, glm::vec3 &min, glm::vec3 &max) {
+		min = item.min;
+		max = item.max;
+	}, [](Item const &item) {
+		return 0.5f * (item.min + item.max);
+	});
+}
+
+bool SceneBVH::refit() {
+	bool changed = false;
+	for (auto &item : items) {
+		item.object->transform->get_local_to_world(); //(brings the stamp up to date)
+		if (item.object->transform->local_to_world_stamp != item.stamp) {
+			update_item(item);
+			changed = true;
+		}
+	}
+	if (!changed) return false;
+
+	//children come after their parents, so walking backward updates children first:
+	for (uint32_t n = uint32_t(nodes.size()) - 1; n < nodes.size(); --n) {
+		BVH::Node &node = nodes[n];
+		if (node.count) {
+			node.min = items[node.first].min;
+			node.max = items[node.first].max;
+			for (uint32_t i = node.first + 1; i < node.first + node.count; ++i) {
+				node.min = glm::min(node.min, items[i].min);
+				node.max = glm::max(node.max, items[i].max);
+			}
+		} else {
+			node.min = glm::min(nodes[node.first].min, nodes[node.first + 1].min);
+			node.max = glm::max(nodes[node.first].max, nodes[node.first + 1].max);
+		}
+	}
+	return true;
+}
+
+template< typename Test, typename Visit >
+void SceneBVH::traverse(Test const &test, Visit const &visit) const {
+	if (nodes.empty()) return;
+	uint32_t stack[BVH::MaxDepth + 1];
+	uint32_t top = 0;
+	stack[top++] = 0;
+	while (top) {
+		BVH::Node const &node = nodes[stack[--top]];
+		if (!test(node.min, node.max)) continue;
+		if (node.count) {
+			for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+				if (test(items[i].min, items[i].max)) visit(items[i]);
+			}
+		} else {
+			assert(top + 2 <= BVH::MaxDepth + 1 && "BVH is deeper than expected.");
+			stack[top++] = node.first + 1;
+			stack[top++] = node.first;
+		}
+	}
+}
+
+void SceneBVH::query_radius(glm::vec3 const &center, float radius, std::vector< Scene::Object const * > &out) const {
+	float radius2 = radius * radius;
+	traverse([&](glm::vec3 const &min, glm::vec3 const &max) {
+		glm::vec3 to_box = glm::clamp(center, min, max) - center;
+		return glm::dot(to_box, to_box) <= radius2;
+	}, [&](Item const &item) {
+		out.emplace_back(item.object);
+	});
+}
+
+void SceneBVH::query_box(glm::vec3 const &query_min, glm::vec3 const &query_max, std::vector< Scene::Object const * > &out) const {
+	traverse([&](glm::vec3 const &min, glm::vec3 const &max) {
+		return min.x <= query_max.x && query_min.x <= max.x
+		    && min.y <= query_max.y && query_min.y <= max.y
+		    && min.z <= query_max.z && query_min.z <= max.z;
+	}, [&](Item const &item) {
+		out.emplace_back(item.object);
+	});
+}
+
+void SceneBVH::query_frustum(glm::mat4 const &world_to_clip, std::vector< Scene::Object const * > &out) const {
+	//frustum planes (-w <= x,y,z <= w) as (normal, offset), inside where dot(normal, p) + offset >= 0:
+	glm::vec4 rows[4];
+	for (uint32_t r = 0; r < 4; ++r) {
+		rows[r] = glm::vec4(world_to_clip[0][r], world_to_clip[1][r], world_to_clip[2][r], world_to_clip[3][r]);
+	}
+	glm::vec4 planes[6] = {
+		rows[3] + rows[0], rows[3] - rows[0],
+		rows[3] + rows[1], rows[3] - rows[1],
+		rows[3] + rows[2], rows[3] - rows[2],
+	};
+	traverse([&](glm::vec3 const &min, glm::vec3 const &max) {
+		for (auto const &plane : planes) {
+			//corner of the box farthest along the plane's normal:
+			glm::vec3 corner = glm::vec3(
+				(plane.x >= 0.0f ? max.x : min.x),
+				(plane.y >= 0.0f ? max.y : min.y),
+				(plane.z >= 0.0f ? max.z : min.z)
+			);
+			if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.0f) return false;
+		}
+		return true;
+	}, [&](Item const &item) {
+		out.emplace_back(item.object);
+	});
+}
+
+void SceneBVH::query_ray(glm::vec3 const &origin, glm::vec3 const &direction, float max_t, std::vector< RayHit > &out) const {
+	float entry = 0.0f; //(set by the test for the visit that follows it)
+	auto test = [&](glm::vec3 const &min, glm::vec3 const &max) {
+		float t = BVH::ray_enters_box(origin, direction, min, max, max_t);
+		if (t < 0.0f) return false;
+		entry = t;
+		return true;
+	};
+	size_t first = out.size();
+	traverse(test, [&](Item const &item) {
+		RayHit hit;
+		hit.distance = entry;
+		hit.object = item.object;
+		out.emplace_back(hit);
+	});
+	std::sort(out.begin() + first, out.end(), [](RayHit const &a, RayHit const &b) {
+		return a.distance < b.distance;
+	});
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Scene.hpp"
+#include "BVH.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+//"SceneBVH" is a bounding volume hierarchy over the objects of a Scene, for "what is near here?" queries:
+//
+//  bvh.build(scene); //once (and again whenever objects are created or deleted)
+//  bvh.refit(); //after moving things (only does work if some object's transform changed)
+//  nearby.clear();
+//  bvh.query_radius(at, 2.0f, nearby);
+//
+// Each object is bounded by its bounding box (Scene::Object::bbox_min/max) in world space,
+// or by its transform's origin if it has no bounding box. Queries are conservative -- they
+// report every object whose world box passes -- so callers may want a finer test afterward.
+//
+// Refitting keeps the shape of the tree, so queries slow down (but stay correct) as objects
+// move far from where they were at build time; build again if that happens.
+
+struct SceneBVH {
+	//(re)build the tree over every object in 'scene':
+	void build(Scene const &scene);
+
+	//update bounds of objects whose transforms have changed since the last build or refit:
+	// returns true if anything changed
+	bool refit();
+
+	//------ queries (results are appended to 'out') ------
+
+	//objects whose boxes overlap the sphere:
+	void query_radius(glm::vec3 const &center, float radius, std::vector< Scene::Object const * > &out) const;
+
+	//objects whose boxes overlap the box [min,max]:
+	void query_box(glm::vec3 const &min, glm::vec3 const &max, std::vector< Scene::Object const * > &out) const;
+
+	//objects whose boxes are not entirely outside one plane of the view frustum:
+	void query_frustum(glm::mat4 const &world_to_clip, std::vector< Scene::Object const * > &out) const;
+
+	//objects whose boxes the ray (origin + t * direction, 0 <= t <= max_t) passes through, nearest first:
+	// (distance is the 't' at which the ray enters the box, or 0 if it starts inside)
+	struct RayHit {
+		float distance;
+		Scene::Object const *object;
+	};
+	void query_ray(glm::vec3 const &origin, glm::vec3 const &direction, float max_t, std::vector< RayHit > &out) const;
+
+	//scratch space for Scene::raycast's query_ray (cleared before each use, so picking doesn't allocate once it has grown):
+	// (so two threads may not raycast through the same bvh at once)
+	mutable std::vector< RayHit > ray_hits;
+
+	//------ internals ------
+
+	struct Item {
+		Scene::Object const *object;
+		glm::vec3 min, max; //world-space bounds
+		uint32_t stamp; //object's transform's local_to_world_stamp when min/max were computed
+	};
+	std::vector< Item > items; //leaves refer to runs of these
+
+	std::vector< BVH::Node > nodes; //(see BVH.hpp)
+
+	//compute an item's world bounds:
+	static void update_item(Item &item);
+
+	//visit leaves whose node boxes pass 'test', calling 'visit' on each item that also passes 'test':
+	template< typename Test, typename Visit >
+	void traverse(Test const &test, Visit const &visit) const;
+};
@@ -0,0 +1,107 @@
+#include "TriangleBVH.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+TriangleBVH::TriangleBVH(std::vector< glm::vec3 > const &triangles) {
+	if (triangles.size() % 3 != 0) {
+		throw std::runtime_error("TriangleBVH expects three vertices per triangle.");
+	}
+	uint32_t count = uint32_t(triangles.size() / 3);
+	if (count == 0) return;
+
+	std::vector< uint32_t > order(count);
+	std::vector< glm::vec3 > centers(count);
+	for (uint32_t t = 0; t < count; ++t) {
+		order[t] = t;
+		centers[t] = (triangles[3 * t + 0] + triangles[3 * t + 1] + triangles[3 * t + 2]) / 3.0f;
+	}
+	BVH::build(nodes, order, [&](uint32_t t, glm::vec3 &min, glm::vec3 &max) {
+		min = glm::min(glm::min(triangles[3 * t + 0], triangles[3 * t + 1]), triangles[3 * t + 2]);
+		max = glm::max(glm::max(triangles[3 * t + 0], triangles[3 * t + 1]), triangles[3 * t + 2]);
+	}, [&](uint32_t t) {
+		return centers[t];
+	});
+
+	//store triangles in leaf order:
+	triangle_indices = std::move(order);
+	positions.reserve(triangles.size());
+	for (uint32_t t : triangle_indices) {
+		positions.emplace_back(triangles[3 * t + 0]);
+		positions.emplace_back(triangles[3 * t + 1]);
+		positions.emplace_back(triangles[3 * t + 2]);
+	}
+}
+
+bool TriangleBVH::raycast(glm::vec3 const &origin, glm::vec3 const &direction, float &max_t, uint32_t *triangle) const {
+	if (nodes.empty()) return false;
+
+	//t at which the ray enters a box, or -1 if it misses the box (or enters past max_t):
+	auto enter = [&](glm::vec3 const &min, glm::vec3 const &max) {
+		return BVH::ray_enters_box(origin, direction, min, max, max_t);
+	};
+
+	bool found = false;
+	uint32_t found_triangle = 0;
+
+	//nodes to visit, with the t at which the ray enters them:
+	struct Entry {
+		uint32_t node;
+		float t;
+	};
+	Entry stack[BVH::MaxDepth + 1];
+	uint32_t top = 0;
+	float t_root = enter(nodes[0].min, nodes[0].max);
+	if (t_root >= 0.0f) stack[top++] = Entry{0, t_root};
+	while (top) {
+		Entry entry = stack[--top];
+		if (entry.t > max_t) continue; //(a closer hit was found since this node was queued)
+		BVH::Node const &node = nodes[entry.node];
+		if (node.count) {
+			for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+				//Moller-Trumbore, accepting either winding:
+				glm::vec3 const &a = positions[3 * i + 0];
+				glm::vec3 edge1 = positions[3 * i + 1] - a;
+				glm::vec3 edge2 = positions[3 * i + 2] - a;
+				glm::vec3 p = glm::cross(direction, edge2);
+				float det = glm::dot(edge1, p);
+				if (det == 0.0f) continue;
+				float inv_det = 1.0f / det;
+				glm::vec3 to_origin = origin - a;
+				float u = glm::dot(to_origin, p) * inv_det;
+				if (u < 0.0f || u > 1.0f) continue;
+				glm::vec3 q = glm::cross(to_origin, edge1);
+				float v = glm::dot(direction, q) * inv_det;
+				if (v < 0.0f || u + v > 1.0f) continue;
+				float t = glm::dot(edge2, q) * inv_det;
+				if (t < 0.0f || t > max_t) continue;
+				max_t = t;
+				found = true;
+				found_triangle = i;
+			}
+			continue;
+		}
+
+		//visit the nearer child first (pushed last), skipping children the ray misses:
+		float t_first = enter(nodes[node.first].min, nodes[node.first].max);
+		float t_second = enter(nodes[node.first + 1].min, nodes[node.first + 1].max);
+		assert(top + 2 <= BVH::MaxDepth + 1 && "BVH is deeper than expected.");
+		if (t_first >= 0.0f && t_second >= 0.0f) {
+			if (t_first <= t_second) {
+				stack[top++] = Entry{node.first + 1, t_second};
+				stack[top++] = Entry{node.first, t_first};
+			} else {
+				stack[top++] = Entry{node.first, t_first};
+				stack[top++] = Entry{node.first + 1, t_second};
+			}
+		} else if (t_first >= 0.0f) {
+			stack[top++] = Entry{node.first, t_first};
+		} else if (t_second >= 0.0f) {
+			stack[top++] = Entry{node.first + 1, t_second};
+		}
+	}
+
+	if (found && triangle) *triangle = triangle_indices[found_triangle];
+	return found;
+}
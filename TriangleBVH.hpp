@@ -0,0 +1,35 @@
+#pragma once
+
+#include "BVH.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+//"TriangleBVH" is a CPU copy of a mesh's triangles with a bounding volume hierarchy over them,
+// for casting rays against the exact surface:
+//
+//  TriangleBVH phone_triangles(meshes->read_positions(meshes->lookup("Phone")));
+//  object->triangles = &phone_triangles; //so Scene::raycast can hit the object
+//
+// Triangles are double-sided. Building is O(n log n); rays visit about O(log n) nodes,
+// nearer child first, and stop descending once nothing closer can be found.
+
+struct TriangleBVH {
+	//build from a triangle list (three vertices per triangle, as from MeshBuffer::read_positions):
+	TriangleBVH(std::vector< glm::vec3 > const &triangles);
+
+	//find the nearest triangle hit by origin + t * direction, for 0 <= t <= max_t:
+	// if found, returns true and sets max_t to the hit's t, and (if non-null) 'triangle' to its
+	// index in the list given to the constructor
+	bool raycast(glm::vec3 const &origin, glm::vec3 const &direction, float &max_t, uint32_t *triangle = nullptr) const;
+
+	//------ internals ------
+
+	//triangles, reordered so that each leaf's triangles are consecutive:
+	std::vector< glm::vec3 > positions; //three per triangle
+	std::vector< uint32_t > triangle_indices; //index in the constructor's list, per triangle
+
+	std::vector< BVH::Node > nodes; //(see BVH.hpp; leaves refer to runs of triangles)
+};
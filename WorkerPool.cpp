@@ -0,0 +1,98 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+WorkerPool::WorkerPool(uint32_t count) : job_next(0), job_remaining(0) {
+	threads.reserve(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		threads.emplace_back(&WorkerPool::worker_main, this);
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		quit = true;
+	}
+	job_ready.notify_all();
+	for (auto &thread : threads) {
+		thread.join();
+	}
+}
+
+WorkerPool &WorkerPool::get() {
+	static WorkerPool pool(std::max(1U, std::thread::hardware_concurrency()) - 1);
+	return pool;
+}
+
+void WorkerPool::run_ranges(std::function< void(uint32_t, uint32_t) > const &fn, uint32_t count, uint32_t grain) {
+	while (true) {
+		uint32_t begin = job_next.fetch_add(grain);
+		if (begin >= count) break;
+		uint32_t end = std::min(count, begin + grain);
+		fn(begin, end);
+		if (job_remaining.fetch_sub(end - begin) == end - begin) {
+			//that was the last range:
+			std::unique_lock< std::mutex > lock(mutex);
+			job_done.notify_all();
+		}
+	}
+}
+
+void WorkerPool::worker_main() {
+	uint32_t seen_generation = 0;
+	while (true) {
+		std::function< void(uint32_t, uint32_t) > const *fn;
+		uint32_t count, grain;
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			job_ready.wait(lock, [&](){ return quit || job_generation != seen_generation; });
+			if (quit) return;
+			seen_generation = job_generation;
+			if (!job_fn) continue; //woke up after the job already finished
+			fn = job_fn;
+			count = job_count;
+			grain = job_grain;
+			active_workers += 1;
+		}
+		run_ranges(*fn, count, grain);
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			active_workers -= 1;
+		}
+		job_done.notify_all();
+	}
+}
+
+void WorkerPool::parallel_for(uint32_t count, uint32_t grain, std::function< void(uint32_t, uint32_t) > const &fn) {
+	if (count == 0) return;
+	grain = std::max(1U, grain);
+
+	//not worth waking anyone:
+	if (threads.empty() || count <= grain) {
+		fn(0, count);
+		return;
+	}
+
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		assert(job_fn == nullptr && "parallel_for is not reentrant.");
+		job_fn = &fn;
+		job_count = count;
+		job_grain = grain;
+		job_next = 0;
+		job_remaining = count;
+		job_generation += 1;
+	}
+	job_ready.notify_all();
+
+	run_ranges(fn, count, grain);
+
+	{
+		//wait for all ranges to finish *and* all workers to leave run_ranges (so the next job can safely reset job_next):
+		std::unique_lock< std::mutex > lock(mutex);
+		job_done.wait(lock, [&](){ return job_remaining == 0 && active_workers == 0; });
+		job_fn = nullptr;
+	}
+}
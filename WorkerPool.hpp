@@ -0,0 +1,53 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+//"WorkerPool" runs data-parallel loops on a set of persistent threads:
+//
+// WorkerPool::get().parallel_for(count, 256, [&](uint32_t begin, uint32_t end){
+//     for (uint32_t i = begin; i < end; ++i) { ... }
+// });
+//
+// The calling thread participates, and parallel_for returns once every range has been processed.
+// The function must be safe to call concurrently on disjoint ranges.
+
+struct WorkerPool {
+	//create a pool with 'threads' workers (in addition to the calling thread):
+	WorkerPool(uint32_t threads);
+	~WorkerPool();
+	WorkerPool(WorkerPool const &) = delete;
+	WorkerPool &operator=(WorkerPool const &) = delete;
+
+	//call fn(begin, end) on ranges of at most 'grain' indices that together cover [0,count):
+	void parallel_for(uint32_t count, uint32_t grain, std::function< void(uint32_t, uint32_t) > const &fn);
+
+	//shared pool with one worker per additional hardware thread:
+	static WorkerPool &get();
+
+	//------ internals ------
+	void worker_main();
+	//process ranges of the current job until none remain:
+	void run_ranges(std::function< void(uint32_t, uint32_t) > const &fn, uint32_t count, uint32_t grain);
+
+	std::vector< std::thread > threads;
+
+	std::mutex mutex;
+	std::condition_variable job_ready; //signaled when a new job is posted (or on shutdown)
+	std::condition_variable job_done; //signaled when the last range of a job finishes or a worker goes idle
+	uint32_t job_generation = 0; //incremented for each job
+	uint32_t active_workers = 0; //workers currently inside run_ranges
+	bool quit = false;
+
+	//current job (written under 'mutex' only while no workers are active):
+	std::function< void(uint32_t, uint32_t) > const *job_fn = nullptr;
+	uint32_t job_count = 0;
+	uint32_t job_grain = 1;
+	std::atomic< uint32_t > job_next; //next index to hand out
+	std::atomic< uint32_t > job_remaining; //indices not yet finished
+};
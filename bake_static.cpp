@@ -0,0 +1,217 @@
+#include "bake_static.hpp"
+#include "quantize.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+MeshBuffer *bake_static(Scene &scene, MeshBuffer const &source, std::vector< GLuint > const &source_vaos, float chunk_size) {
+	if (source.data.empty()) {
+		throw std::runtime_error("bake_static requires a MeshBuffer constructed with keep_data.");
+	}
+	auto is_float3 = [](MeshBuffer::Attrib const &attrib) {
+		return attrib.size == 3 && attrib.type == GL_FLOAT;
+	};
+	bool quantized = source.quantized(); //(positions and normals as in quantize.hpp)
+	if (!quantized && (!is_float3(source.Position) || (source.Normal.size != 0 && !is_float3(source.Normal)))) {
+		throw std::runtime_error("bake_static only handles float3 or quantized positions and normals.");
+	}
+	GLsizei stride = source.Position.stride;
+
+	//group objects by (program, material, chunk):
+	// (std::map so that the baked buffer's layout doesn't depend on pointer values;
+	//  materials are numbered in the order they are first seen for the same reason)
+	std::map< std::tuple< GLuint, uint32_t, int32_t, int32_t, int32_t >, std::vector< Scene::Object * > > chunks;
+	std::vector< Material const * > materials;
+	for (Scene::Object &object : scene.objects) {
+		if (!object.is_static || object.occluder || object.triangles || !object.lods.empty()) continue;
+		if (std::find(source_vaos.begin(), source_vaos.end(), object.vao) == source_vaos.end()) continue;
+		//(vaos are shared by every MeshBuffer in the same GeometryArena block, so also check that the object draws from 'source'):
+		if (object.index_type != source.index_type) continue;
+		if (object.index_type != 0 ? !(object.start >= source.index_base && size_t(object.start - source.index_base) + object.count <= source.indices.size())
+		                           : !(object.start >= source.vertex_base && (size_t(object.start - source.vertex_base) + object.count) * stride <= source.data.size())) continue;
+
+		glm::mat4 const &local_to_world = object.transform->get_local_to_world();
+		glm::vec3 center = glm::vec3(local_to_world[3]);
+		if (object.bbox_min.x <= object.bbox_max.x) {
+			center = glm::vec3(local_to_world * glm::vec4(0.5f * (object.bbox_min + object.bbox_max), 1.0f));
+		}
+		glm::ivec3 cell = glm::ivec3(0);
+		if (chunk_size > 0.0f) {
+			cell = glm::ivec3(glm::floor(center / chunk_size));
+		}
+		uint32_t material = uint32_t(std::find(materials.begin(), materials.end(), object.material) - materials.begin());
+		if (material == materials.size()) materials.emplace_back(object.material);
+		chunks[std::make_tuple(object.program, material, cell.x, cell.y, cell.z)].emplace_back(&object);
+	}
+	if (chunks.empty()) return nullptr;
+
+	//copy and transform vertices of each chunk:
+	// (if the source is indexed, so is the result: each object's vertices are copied once
+	//  and its indices are offset to match)
+	struct Chunk {
+		Scene::Object const *like; //program and material info is copied from this object
+		GLuint start, count; //vertices
+		GLuint index_start, index_count; //indices (if indexed)
+		glm::vec3 min, max; //world-space bounds
+		glm::vec3 position_offset = glm::vec3(0.0f); //(see MeshBuffer::Mesh)
+		glm::vec3 position_scale = glm::vec3(1.0f);
+	};
+	std::vector< Chunk > baked;
+	std::vector< uint8_t > data;
+	std::vector< uint32_t > indices;
+	for (auto const &chunk : chunks) {
+		Chunk c;
+		c.like = chunk.second[0];
+		c.start = GLuint(data.size() / stride);
+		c.count = 0;
+		c.index_start = GLuint(indices.size());
+		c.index_count = 0;
+		c.min = glm::vec3( std::numeric_limits< float >::infinity());
+		c.max = glm::vec3(-std::numeric_limits< float >::infinity());
+
+		//world-space positions of the chunk's vertices (stored once the chunk's box is known):
+		std::vector< glm::vec3 > positions;
+
+		for (Scene::Object const *object : chunk.second) {
+			glm::mat4 const &local_to_world = object->transform->get_local_to_world();
+			//NOTE: inverse cancels out transpose unless there is scale involved
+			glm::mat3 normal_to_world = glm::inverse(glm::transpose(glm::mat3(local_to_world)));
+
+			//range of source vertices the object uses (in source.data, so not counting source.vertex_base):
+			GLuint first = object->start - source.vertex_base;
+			GLuint last = first + object->count;
+			if (source.index_type != 0) {
+				GLuint index_begin = object->start - source.index_base;
+				GLuint index_end = index_begin + object->count;
+				first = std::numeric_limits< GLuint >::max();
+				last = 0;
+				for (GLuint i = index_begin; i < index_end; ++i) {
+					first = std::min(first, source.indices[i]);
+					last = std::max(last, source.indices[i] + 1);
+				}
+				if (first > last) first = last; //(no indices)
+				GLuint base = GLuint(data.size() / stride);
+				for (GLuint i = index_begin; i < index_end; ++i) {
+					indices.emplace_back(source.indices[i] - first + base);
+				}
+				c.index_count += object->count;
+			}
+
+			size_t begin = data.size();
+			data.insert(data.end(), source.data.begin() + size_t(first) * stride, source.data.begin() + size_t(last) * stride);
+			for (GLuint i = 0; i < last - first; ++i) {
+				uint8_t *vertex = &data[begin + size_t(i) * stride];
+
+				glm::vec3 position;
+				if (quantized) {
+					QuantizedPosition q;
+					std::memcpy(&q, vertex + source.Position.offset, sizeof(q));
+					position = dequantize_position(q, object->position_offset, object->position_scale);
+				} else {
+					std::memcpy(&position, vertex + source.Position.offset, sizeof(position));
+				}
+				position = glm::vec3(local_to_world * glm::vec4(position, 1.0f));
+				positions.emplace_back(position);
+				c.min = glm::min(c.min, position);
+				c.max = glm::max(c.max, position);
+
+				if (source.Normal.size != 0) {
+					if (quantized) {
+						uint32_t q;
+						std::memcpy(&q, vertex + source.Normal.offset, sizeof(q));
+						q = quantize_normal(glm::normalize(normal_to_world * dequantize_normal(q)));
+						std::memcpy(vertex + source.Normal.offset, &q, sizeof(q));
+					} else {
+						glm::vec3 normal;
+						std::memcpy(&normal, vertex + source.Normal.offset, sizeof(normal));
+						normal = normal_to_world * normal;
+						std::memcpy(vertex + source.Normal.offset, &normal, sizeof(normal));
+					}
+				}
+			}
+			c.count += last - first;
+		}
+
+		//quantized chunks are relative to the chunk's box:
+		if (quantized && c.count > 0) {
+			c.position_offset = c.min;
+			c.position_scale = c.max - c.min;
+		}
+		for (GLuint i = 0; i < c.count; ++i) {
+			uint8_t *vertex = &data[(size_t(c.start) + i) * stride];
+			if (quantized) {
+				QuantizedPosition q = quantize_position(positions[i], c.position_offset, c.position_scale);
+				std::memcpy(vertex + source.Position.offset, &q, sizeof(q));
+			} else {
+				std::memcpy(vertex + source.Position.offset, &positions[i], sizeof(positions[i]));
+			}
+		}
+		baked.emplace_back(c);
+	}
+
+	MeshBuffer *ret = new MeshBuffer(source, data, indices);
+
+	//replace each chunk's objects with a single object:
+	std::map< GLuint, GLuint > program_vaos;
+	GLuint depth_vao = 0; //(made if any baked object had a depth_vao)
+	for (uint32_t i = 0; i < baked.size(); ++i) {
+		Chunk const &c = baked[i];
+		GLuint program = c.like->program;
+		if (!program_vaos.count(program)) {
+			program_vaos[program] = ret->make_vao_for_program(program);
+		}
+
+		MeshBuffer::Mesh mesh;
+		mesh.start = ret->vertex_base + c.start;
+		mesh.count = c.count;
+		mesh.index_start = ret->index_base + c.index_start;
+		mesh.index_count = c.index_count;
+		mesh.position_offset = c.position_offset;
+		mesh.position_scale = c.position_scale;
+		if (mesh.count > 0) {
+			mesh.min = c.min;
+			mesh.max = c.max;
+			mesh.center = 0.5f * (c.min + c.max);
+			mesh.radius = 0.5f * glm::length(c.max - c.min); //(bounds the box, so also the vertices)
+		}
+		ret->meshes.insert(std::make_pair("static." + std::to_string(i), mesh));
+
+		Scene::Object *object = scene.new_object(scene.new_transform());
+		object->program = program;
+		object->program_mvp_mat4 = c.like->program_mvp_mat4;
+		object->program_mv_mat4x3 = c.like->program_mv_mat4x3;
+		object->program_itmv_mat3 = c.like->program_itmv_mat3;
+		object->program_object_block = c.like->program_object_block;
+		object->program_world_to_clip_mat4 = c.like->program_world_to_clip_mat4;
+		object->material = c.like->material;
+		object->vao = program_vaos[program];
+		if (c.like->depth_vao != 0) {
+			if (depth_vao == 0) depth_vao = ret->make_position_vao();
+			object->depth_vao = depth_vao;
+		}
+		object->index_type = ret->index_type;
+		object->position_offset = mesh.position_offset;
+		object->position_scale = mesh.position_scale;
+		object->start = (ret->index_type != 0 ? mesh.index_start : mesh.start);
+		object->count = (ret->index_type != 0 ? mesh.index_count : mesh.count);
+		object->bbox_min = mesh.min;
+		object->bbox_max = mesh.max;
+		object->is_static = true;
+	}
+
+	for (auto const &chunk : chunks) {
+		for (Scene::Object *object : chunk.second) {
+			scene.delete_object(object);
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Scene.hpp"
+#include "MeshBuffer.hpp"
+
+#include <vector>
+
+//Merges static objects into pre-transformed (world-space) geometry:
+// Every object in 'scene' that has is_static set, no occluder, triangles, or lods, a vao in 'source_vaos'
+// (i.e., one made by source.make_vao_for_program), and a vertex range in 'source' has its vertices
+// transformed to world space and copied into a new MeshBuffer, which is returned.
+//
+// The original objects are deleted (their transforms are kept) and replaced by one object
+// per program and material per 'chunk_size'-sized cell of space (so chunks can still be frustum culled),
+// each attached to a new identity transform.
+//
+// 'source' must have been constructed with keep_data, and must store positions (and normals,
+// if present) as three floats or quantized (see quantize.hpp).
+// The returned buffer has the same vertex layout as 'source', and is indexed if 'source' is.
+// Returns nullptr if no objects were baked; otherwise the caller owns the returned buffer,
+// which must outlive the scene's baked objects.
+MeshBuffer *bake_static(Scene &scene, MeshBuffer const &source, std::vector< GLuint > const &source_vaos, float chunk_size = 10.0f);
@@ -0,0 +1,28 @@
+#include "depth_program.hpp"
+
+#include "compile_program.hpp"
+
+DepthProgram::DepthProgram() {
+	program = compile_program(
+		"#version 330\n"
+		"uniform mat4 world_to_clip;\n"
+		"uniform mat4x3 object_to_light;\n"
+		"layout(location=0) in vec4 Position;\n" //position-only vaos (see MeshBuffer::make_position_vao) bind location 0
+		"invariant gl_Position;\n"
+		"void main() {\n"
+		"	vec3 position = object_to_light * Position;\n"
+		"	gl_Position = world_to_clip * vec4(position, 1.0);\n"
+		"}\n"
+		,
+		"#version 330\n"
+		"void main() {\n"
+		"}\n"
+	);
+
+	world_to_clip_mat4 = glGetUniformLocation(program, "world_to_clip");
+	object_to_light_mat4x3 = glGetUniformLocation(program, "object_to_light");
+}
+
+Load< DepthProgram > depth_program(LoadTagInit, [](){
+	return new DepthProgram();
+});
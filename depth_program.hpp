@@ -0,0 +1,18 @@
+#include "GL.hpp"
+#include "Load.hpp"
+
+//Writes depth only; used by RenderQueue's depth pre-pass (see RenderQueue.hpp).
+// gl_Position is computed exactly as in vertex_color_program (and declared invariant in both),
+// so the color pass can draw with GL_LEQUAL against the pre-pass depth.
+struct DepthProgram {
+	//opengl program object:
+	GLuint program = 0;
+
+	//uniform locations:
+	GLuint world_to_clip_mat4 = -1U;
+	GLuint object_to_light_mat4x3 = -1U;
+
+	DepthProgram();
+};
+
+extern Load< DepthProgram > depth_program;
@@ -1,6 +1,7 @@
 #include "draw_text.hpp"
 
 #include "GL.hpp"
+#include "GLState.hpp"
 #include "Load.hpp"
 #include "MeshBuffer.hpp"
 #include "data_path.hpp"
@@ -78,8 +79,8 @@ void draw_text(std::string const &text, glm::vec2 const &anchor, float height, g
 }
 
 void draw_text(std::string const &text, glm::mat4 const &transform, glm::vec4 color) {
-	glUseProgram(*text_program);
-	glBindVertexArray(*text_meshes_for_text_program);
+	GLState::use_program(*text_program);
+	GLState::bind_vertex_array(*text_meshes_for_text_program);
 
 	float x = 0.0f;
 	for (uint32_t i = 0; i < text.size(); ++i) {
@@ -103,8 +104,8 @@ void draw_text(std::string const &text, glm::mat4 const &transform, glm::vec4 co
 	}
 
 
-	glBindVertexArray(0);
-	glUseProgram(0);
+	GLState::bind_vertex_array(0);
+	GLState::use_program(0);
 }
 
 float text_width(std::string const &text, float height) {
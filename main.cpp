@@ -12,6 +12,9 @@
 //GL.hpp will include a non-namespace-polluting set of opengl prototypes:
 #include "GL.hpp"
 
+//GLState.hpp tracks OpenGL state to skip redundant calls:
+#include "GLState.hpp"
+
 //Includes for libSDL:
 #include <SDL.h>
 
@@ -27,14 +30,35 @@
 #include <fstream>
 #include <memory>
 #include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
 
 int main(int argc, char **argv) {
 	struct {
 		//TODO: this is where you set the title and size of your game window
 		std::string title = "A.I.N.A.T.O.P.B.";
 		glm::uvec2 size = glm::uvec2(640, 400);
+		//draw and swap on a separate thread that owns the OpenGL context, overlapping the next frame's update:
+		bool render_thread = false;
+		//print average update / draw / swap / frame times every few seconds:
+		bool frame_times = false;
 	} config;
 
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--render-thread") {
+			config.render_thread = true;
+		} else if (arg == "--frame-times") {
+			config.frame_times = true;
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--render-thread] [--frame-times]" << std::endl;
+			return 1;
+		}
+	}
+
 	//------------  initialization ------------
 
 	//Initialize SDL library:
@@ -120,14 +144,121 @@ int main(int argc, char **argv) {
 		window_size = glm::uvec2(w, h);
 		SDL_GL_GetDrawableSize(window, &w, &h);
 		drawable_size = glm::uvec2(w, h);
-		glViewport(0, 0, drawable_size.x, drawable_size.y);
 	};
 	on_resize();
 
+	//time spent in each part of the frame, averaged and printed with --frame-times:
+	// (with --render-thread, update overlaps the previous frame's draw and swap, so the parts can add up to more than a frame)
+	typedef std::chrono::high_resolution_clock Clock;
+	struct {
+		std::mutex mutex; //(draw and swap are recorded by the render thread)
+		double update = 0.0; //handling events, updating, and preparing to draw
+		double wait = 0.0; //main thread waiting for the render thread
+		double draw = 0.0; //drawing (i.e., submitting GL commands)
+		double swap = 0.0; //waiting in SDL_GL_SwapWindow (e.g., for vsync)
+		uint32_t frames = 0;
+		Clock::time_point start = Clock::now();
+	} times;
+	auto record_time = [&times](double &total, Clock::time_point const &begin, Clock::time_point const &end) {
+		std::unique_lock< std::mutex > lock(times.mutex);
+		total += std::chrono::duration< double >(end - begin).count();
+	};
+	auto report_times = [&times](){
+		std::unique_lock< std::mutex > lock(times.mutex);
+		times.frames += 1;
+		Clock::time_point now = Clock::now();
+		double total = std::chrono::duration< double >(now - times.start).count();
+		if (total < 5.0) return;
+		double ms = 1000.0 / times.frames;
+		double overlap = std::max(0.0, times.update + times.draw + times.swap - total);
+		std::cout << std::fixed << std::setprecision(2)
+			<< "frame " << total * ms << "ms: update " << times.update * ms << "ms, draw " << times.draw * ms
+			<< "ms, swap " << times.swap * ms << "ms, main waited " << times.wait * ms
+			<< "ms, overlapped " << overlap * ms << "ms" << std::endl;
+		times.update = times.wait = times.draw = times.swap = 0.0;
+		times.frames = 0;
+		times.start = now;
+	};
+
+	//draw a frame of 'mode' and show it (on whichever thread has the OpenGL context):
+	auto draw_frame = [&window, &times, &record_time](Mode &mode, glm::uvec2 const &drawable_size) {
+		Clock::time_point before = Clock::now();
+
+		glViewport(0, 0, drawable_size.x, drawable_size.y);
+
+		//clear the depth+color buffers and set some default state:
+		glClearColor(0.5, 0.5, 0.5, 0.0);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		GLState::enable(GL_DEPTH_TEST);
+		GLState::enable(GL_BLEND);
+		GLState::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		mode.draw(drawable_size);
+		GLState::end_frame();
+
+		Clock::time_point drawn = Clock::now();
+
+		//wait until the recently-drawn frame is shown:
+		SDL_GL_SwapWindow(window);
+
+		record_time(times.draw, before, drawn);
+		record_time(times.swap, drawn, Clock::now());
+	};
+
+	//with --render-thread, frames to draw are passed to the render thread through a short queue:
+	struct Frame {
+		std::shared_ptr< Mode > mode; //(keeps the mode alive until it is drawn)
+		glm::uvec2 drawable_size;
+	};
+	const constexpr uint32_t MaxQueuedFrames = 1; //how many frames update may run ahead of draw
+	struct {
+		std::thread thread;
+		std::mutex mutex;
+		std::condition_variable changed; //queue popped, frame drawn, or quit set
+		std::deque< Frame > queue;
+		uint64_t submitted = 0; //frames pushed to the queue
+		uint64_t drawn = 0; //frames drawn and swapped
+		bool quit = false;
+	} render;
+
+	if (config.render_thread) {
+		//hand the OpenGL context over to the render thread:
+		SDL_GL_MakeCurrent(window, nullptr);
+		render.thread = std::thread([&](){
+			SDL_GL_MakeCurrent(window, context);
+			//the most recently drawn mode stays referenced here so that, when a mode is dropped,
+			// it is usually destroyed on this thread, where its GL objects can be freed:
+			std::shared_ptr< Mode > drawn_mode;
+			while (true) {
+				Frame frame;
+				{
+					std::unique_lock< std::mutex > lock(render.mutex);
+					render.changed.wait(lock, [&render](){ return !render.queue.empty() || render.quit; });
+					if (render.queue.empty()) break;
+					frame = std::move(render.queue.front());
+					render.queue.pop_front();
+				}
+				render.changed.notify_all();
+
+				draw_frame(*frame.mode, frame.drawable_size);
+				drawn_mode = std::move(frame.mode);
+
+				{
+					std::unique_lock< std::mutex > lock(render.mutex);
+					render.drawn += 1;
+				}
+				render.changed.notify_all();
+			}
+			drawn_mode.reset();
+			SDL_GL_MakeCurrent(window, nullptr);
+		});
+	}
+
 	//This will loop until the current mode is set to null:
 	while (Mode::current) {
 		//every pass through the game loop creates one frame of output
 		//  by performing three steps:
+		Clock::time_point frame_begin = Clock::now();
 
 		{ //(1) process any events that are pending
 			static SDL_Event evt;
@@ -162,18 +293,41 @@ int main(int argc, char **argv) {
 		}
 
 		{ //(3) call the current mode's "draw" function to produce output:
-			//clear the depth+color buffers and set some default state:
-			glClearColor(0.5, 0.5, 0.5, 0.0);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			glEnable(GL_DEPTH_TEST);
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-			Mode::current->draw(drawable_size);
+			Mode::current->prepare_draw();
+			Clock::time_point prepared = Clock::now();
+			record_time(times.update, frame_begin, prepared);
+
+			if (!config.render_thread) {
+				draw_frame(*Mode::current, drawable_size);
+			} else {
+				//queue the frame, waiting if the render thread is already a full queue behind:
+				std::unique_lock< std::mutex > lock(render.mutex);
+				render.changed.wait(lock, [&render](){ return render.queue.size() < MaxQueuedFrames; });
+				render.queue.emplace_back(Frame{Mode::current, drawable_size});
+				render.submitted += 1;
+				render.changed.notify_all();
+
+				//modes that draw from live state must finish drawing before the next events and update:
+				if (!Mode::current->draws_concurrently()) {
+					render.changed.wait(lock, [&render](){ return render.drawn == render.submitted; });
+				}
+				lock.unlock();
+				record_time(times.wait, prepared, Clock::now());
+			}
 		}
 
-		//Finally, wait until the recently-drawn frame is shown before doing it all again:
-		SDL_GL_SwapWindow(window);
+		if (config.frame_times) report_times();
+	}
+
+	if (render.thread.joinable()) {
+		//finish drawing queued frames, then take the OpenGL context back:
+		{
+			std::unique_lock< std::mutex > lock(render.mutex);
+			render.quit = true;
+		}
+		render.changed.notify_all();
+		render.thread.join();
+		SDL_GL_MakeCurrent(window, context);
 	}
 
 
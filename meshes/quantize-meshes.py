@@ -0,0 +1,127 @@
+#!/usr/bin/env python
+
+#Converts a mesh blob written by export-meshes.py to a quantized version (see quantize.hpp):
+# positions become 16-bit normalized values relative to a box per mesh,
+# normals become GL_INT_2_10_10_10_REV, and texture coordinates become half floats.
+#
+#Meshes named "<name>.LOD<n>" are quantized relative to the same box as "<name>",
+# so that an object can switch between them without changing how positions are decoded.
+
+import sys,re,struct
+
+if len(sys.argv) != 3:
+	print("\n\nUsage:\npython quantize-meshes.py <infile.pnc|.pnct> <outfile.qpnc|.qpnct>\nWrites a quantized copy of a mesh blob.\n")
+	exit(1)
+
+infile = sys.argv[1]
+outfile = sys.argv[2]
+
+filetypes = {
+	(".pnc", ".qpnc") : (b"pnc.", b"qpnc"),
+	(".pnct", ".qpnct") : (b"pnct", b"qpnt"),
+}
+
+filetype = None
+for exts, magics in filetypes.items():
+	if infile.endswith(exts[0]) and outfile.endswith(exts[1]):
+		filetype = magics
+
+if filetype == None:
+	print("ERROR: please convert one of:")
+	for exts in filetypes.keys():
+		print("\t\"" + exts[0] + "\" -> \"" + exts[1] + "\"")
+	exit(1)
+
+has_texcoord = (filetype[0] == b"pnct")
+
+blob = open(infile, 'rb').read()
+at = 0
+def read_chunk(magic):
+	global at
+	(got, length) = struct.unpack('4sI', blob[at:at+8])
+	if got != magic:
+		print("ERROR: expected chunk '" + magic.decode() + "', got '" + got.decode() + "'.")
+		exit(1)
+	at += 8 + length
+	return blob[at-length:at]
+
+data = read_chunk(filetype[0])
+strings = read_chunk(b'str0')
+index = read_chunk(b'idx0')
+
+vertex_format = '3f3f4B' + ('2f' if has_texcoord else '')
+vertex_bytes = struct.calcsize('<' + vertex_format)
+vertices = [struct.unpack_from('<' + vertex_format, data, i) for i in range(0, len(data), vertex_bytes)]
+
+entries = [struct.unpack_from('IIII', index, i) for i in range(0, len(index), 16)]
+
+#box of each mesh:
+def name_of(entry):
+	return strings[entry[0]:entry[1]].decode()
+boxes = {}
+for entry in entries:
+	mins = [float('inf')] * 3
+	maxs = [float('-inf')] * 3
+	for v in vertices[entry[2]:entry[3]]:
+		for a in range(0,3):
+			mins[a] = min(mins[a], v[a])
+			maxs[a] = max(maxs[a], v[a])
+	boxes[name_of(entry)] = (mins, maxs)
+
+#...grown to cover all levels of detail:
+def family_of(name):
+	m = re.match(r'^(.*)\.LOD\d+$', name)
+	return m.group(1) if m else name
+family_boxes = {}
+for name, (mins, maxs) in boxes.items():
+	family = family_of(name)
+	if family not in family_boxes:
+		family_boxes[family] = ([float('inf')] * 3, [float('-inf')] * 3)
+	fmins, fmaxs = family_boxes[family]
+	for a in range(0,3):
+		fmins[a] = min(fmins[a], mins[a])
+		fmaxs[a] = max(fmaxs[a], maxs[a])
+
+def clamp(x, lo, hi):
+	return max(lo, min(hi, x))
+
+#box used for each vertex:
+vertex_boxes = [None] * len(vertices)
+out_boxes = b''
+for entry in entries:
+	mins, maxs = family_boxes[family_of(name_of(entry))]
+	if mins[0] > maxs[0]: #(empty mesh)
+		mins, maxs = [0.0] * 3, [0.0] * 3
+	box = (mins, [maxs[a] - mins[a] for a in range(0,3)])
+	out_boxes += struct.pack('<6f', *(box[0] + box[1]))
+	for i in range(entry[2], entry[3]):
+		if vertex_boxes[i] != None and vertex_boxes[i] != box:
+			print("ERROR: vertex " + str(i) + " is shared by meshes with different boxes.")
+			exit(1)
+		vertex_boxes[i] = box
+
+out_data = b''
+for v, box in zip(vertices, vertex_boxes):
+	if box == None: #(not in any mesh)
+		box = ([0.0] * 3, [0.0] * 3)
+	offset, scale = box
+	q = [int(round(clamp((v[a] - offset[a]) / scale[a], 0.0, 1.0) * 65535.0)) if scale[a] != 0.0 else 0 for a in range(0,3)]
+	out_data += struct.pack('<4H', q[0], q[1], q[2], 0xffff)
+	n = 0
+	for a in range(0,3):
+		n |= (int(round(clamp(v[3+a], -1.0, 1.0) * 511.0)) & 0x3ff) << (10 * a)
+	out_data += struct.pack('<I', n)
+	out_data += struct.pack('<4B', *v[6:10])
+	if has_texcoord:
+		out_data += struct.pack('<2e', v[10], v[11])
+
+#(vertex ranges are unchanged, so the index chunk is copied as-is)
+out = open(outfile, 'wb')
+for magic, chunk in [(filetype[1], out_data), (b'str0', strings), (b'idx0', index), (b'box0', out_boxes)]:
+	out.write(struct.pack('4s', magic))
+	out.write(struct.pack('I', len(chunk)))
+	out.write(chunk)
+wrote = out.tell()
+out.close()
+
+print("Wrote " + str(wrote) + " bytes [" + str(len(out_data)) + " bytes of vertices, was " + str(len(data)) + "] to '" + outfile + "'")
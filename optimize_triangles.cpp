@@ -0,0 +1,261 @@
+#include "optimize_triangles.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace {
+	//FIFO vertex cache: a vertex stays cached until 'size' other vertices have been loaded after it.
+	struct FIFOCache {
+		FIFOCache(uint32_t vertex_count, uint32_t size_) : size(size_), time(size_ + 1), loaded_at(vertex_count, 0) { }
+		uint32_t size;
+		uint32_t time; //counts loads (starts past 'size' so that nothing is cached)
+		std::vector< uint32_t > loaded_at;
+
+		//returns true (and loads 'v') if 'v' wasn't cached:
+		bool miss(uint32_t v) {
+			if (time - loaded_at[v] > size) {
+				loaded_at[v] = time;
+				time += 1;
+				return true;
+			}
+			return false;
+		}
+		//empty the cache:
+		void reset() {
+			time += size + 1;
+		}
+	};
+}
+
+VertexCacheStats vertex_cache_stats(std::vector< uint32_t > const &indices, uint32_t vertex_count, uint32_t cache_size) {
+	VertexCacheStats ret;
+	if (indices.empty()) return ret;
+
+	FIFOCache cache(vertex_count, cache_size);
+	std::vector< bool > used(vertex_count, false);
+	uint32_t misses = 0;
+	uint32_t used_count = 0;
+	for (uint32_t v : indices) {
+		assert(v < vertex_count);
+		if (cache.miss(v)) misses += 1;
+		if (!used[v]) {
+			used[v] = true;
+			used_count += 1;
+		}
+	}
+	ret.acmr = misses / float(indices.size() / 3);
+	ret.atvr = misses / float(used_count);
+	return ret;
+}
+
+std::vector< uint32_t > optimize_vertex_cache(std::vector< uint32_t > &indices, uint32_t vertex_count, uint32_t cache_size) {
+	uint32_t triangle_count = uint32_t(indices.size() / 3);
+
+	//triangles using each vertex ('live' counts the ones not yet emitted):
+	std::vector< uint32_t > live(vertex_count, 0);
+	for (uint32_t v : indices) {
+		assert(v < vertex_count);
+		live[v] += 1;
+	}
+	std::vector< uint32_t > first(vertex_count + 1, 0); //vertex v's triangles are adjacent[first[v]] .. adjacent[first[v+1]-1]
+	for (uint32_t v = 0; v < vertex_count; ++v) {
+		first[v+1] = first[v] + live[v];
+	}
+	std::vector< uint32_t > adjacent(3 * triangle_count);
+	{
+		std::vector< uint32_t > next(first.begin(), first.end() - 1);
+		for (uint32_t i = 0; i < 3 * triangle_count; ++i) {
+			adjacent[next[indices[i]]++] = i / 3;
+		}
+	}
+
+	std::vector< bool > emitted(triangle_count, false);
+	std::vector< uint32_t > loaded_at(vertex_count, 0);
+	uint32_t time = cache_size + 1;
+
+	std::vector< uint32_t > dead_ends; //recently used vertices, to resume from when a fan runs out
+	uint32_t cursor = 0; //...and, failing those, the first vertex that might still have triangles
+
+	//(returns vertex_count once every triangle has been emitted)
+	auto skip_dead_end = [&]() -> uint32_t {
+		while (!dead_ends.empty()) {
+			uint32_t v = dead_ends.back();
+			dead_ends.pop_back();
+			if (live[v] > 0) return v;
+		}
+		while (cursor < vertex_count) {
+			if (live[cursor] > 0) return cursor;
+			++cursor;
+		}
+		return vertex_count;
+	};
+
+	std::vector< uint32_t > ordered;
+	ordered.reserve(3 * triangle_count);
+	std::vector< uint32_t > clusters;
+	std::vector< uint32_t > candidates;
+
+	uint32_t fan = skip_dead_end();
+	if (fan != vertex_count) clusters.emplace_back(0);
+	while (fan != vertex_count) {
+		//emit every remaining triangle around 'fan':
+		candidates.clear();
+		for (uint32_t a = first[fan]; a < first[fan+1]; ++a) {
+			uint32_t t = adjacent[a];
+			if (emitted[t]) continue;
+			emitted[t] = true;
+			for (uint32_t k = 0; k < 3; ++k) {
+				uint32_t v = indices[3*t+k];
+				ordered.emplace_back(v);
+				dead_ends.emplace_back(v);
+				candidates.emplace_back(v);
+				live[v] -= 1;
+				if (time - loaded_at[v] > cache_size) {
+					loaded_at[v] = time;
+					time += 1;
+				}
+			}
+		}
+
+		//fan around the candidate that has been cached longest, as long as it will still be cached once its triangles are emitted:
+		uint32_t next = vertex_count;
+		int32_t best = -1;
+		for (uint32_t v : candidates) {
+			if (live[v] == 0) continue;
+			int32_t priority = 0;
+			if (time - loaded_at[v] + 2 * live[v] <= cache_size) priority = int32_t(time - loaded_at[v]);
+			if (priority > best) {
+				best = priority;
+				next = v;
+			}
+		}
+		if (next == vertex_count) {
+			next = skip_dead_end();
+			if (next != vertex_count) clusters.emplace_back(uint32_t(ordered.size() / 3));
+		}
+		fan = next;
+	}
+
+	indices = std::move(ordered);
+	return clusters;
+}
+
+void optimize_overdraw(std::vector< uint32_t > &indices, std::vector< glm::vec3 > const &positions, std::vector< uint32_t > const &clusters, float threshold, uint32_t cache_size) {
+	uint32_t triangle_count = uint32_t(indices.size() / 3);
+	if (triangle_count == 0) return;
+
+	FIFOCache cache(uint32_t(positions.size()), cache_size);
+	auto misses = [&](uint32_t t) {
+		return uint32_t(cache.miss(indices[3*t+0])) + uint32_t(cache.miss(indices[3*t+1])) + uint32_t(cache.miss(indices[3*t+2]));
+	};
+
+	//split clusters wherever the triangles so far have a good enough ACMR on their own:
+	std::vector< uint32_t > starts;
+	for (uint32_t c = 0; c < clusters.size(); ++c) {
+		uint32_t begin = (c == 0 ? 0 : clusters[c]); //(the first cluster always starts at the first triangle)
+		uint32_t end = (c + 1 < clusters.size() ? clusters[c+1] : triangle_count);
+		if (begin >= end) continue;
+
+		cache.reset();
+		uint32_t cluster_misses = 0;
+		for (uint32_t t = begin; t < end; ++t) {
+			cluster_misses += misses(t);
+		}
+		float limit = threshold * cluster_misses / float(end - begin);
+
+		starts.emplace_back(begin);
+		cache.reset();
+		uint32_t running_misses = 0;
+		uint32_t running_triangles = 0;
+		for (uint32_t t = begin; t + 1 < end; ++t) {
+			running_misses += misses(t);
+			running_triangles += 1;
+			if (running_misses <= limit * running_triangles) {
+				starts.emplace_back(t + 1);
+				cache.reset();
+				running_misses = 0;
+				running_triangles = 0;
+			}
+		}
+	}
+	if (starts.empty()) starts.emplace_back(0);
+
+	//area-weighted centroid and normal of a range of triangles:
+	auto centroid_and_normal = [&](uint32_t begin, uint32_t end, glm::vec3 *centroid, glm::vec3 *normal) {
+		glm::vec3 weighted = glm::vec3(0.0f);
+		float area = 0.0f;
+		*normal = glm::vec3(0.0f);
+		for (uint32_t t = begin; t < end; ++t) {
+			glm::vec3 const &a = positions[indices[3*t+0]];
+			glm::vec3 const &b = positions[indices[3*t+1]];
+			glm::vec3 const &c = positions[indices[3*t+2]];
+			glm::vec3 n = glm::cross(b - a, c - a);
+			float l = glm::length(n);
+			weighted += l * (a + b + c) / 3.0f;
+			area += l;
+			*normal += n;
+		}
+		*centroid = (area > 0.0f ? weighted / area : glm::vec3(0.0f));
+		float l = glm::length(*normal);
+		if (l > 0.0f) *normal /= l;
+	};
+
+	glm::vec3 mesh_centroid, mesh_normal;
+	centroid_and_normal(0, triangle_count, &mesh_centroid, &mesh_normal);
+
+	//draw clusters that face away from the middle of the mesh (so are likely in front of the rest) first:
+	struct Cluster {
+		uint32_t begin, end;
+		float outwardness;
+	};
+	std::vector< Cluster > sorted;
+	sorted.reserve(starts.size());
+	for (uint32_t s = 0; s < starts.size(); ++s) {
+		Cluster cluster;
+		cluster.begin = starts[s];
+		cluster.end = (s + 1 < starts.size() ? starts[s+1] : triangle_count);
+		glm::vec3 centroid, normal;
+		centroid_and_normal(cluster.begin, cluster.end, &centroid, &normal);
+		cluster.outwardness = glm::dot(centroid - mesh_centroid, normal);
+		sorted.emplace_back(cluster);
+	}
+	std::stable_sort(sorted.begin(), sorted.end(), [](Cluster const &a, Cluster const &b){
+		return a.outwardness > b.outwardness;
+	});
+
+	std::vector< uint32_t > ordered;
+	ordered.reserve(indices.size());
+	for (Cluster const &cluster : sorted) {
+		ordered.insert(ordered.end(), indices.begin() + 3 * cluster.begin, indices.begin() + 3 * cluster.end);
+	}
+	indices = std::move(ordered);
+}
+
+std::vector< uint32_t > order_vertices_by_first_use(std::vector< uint32_t > &indices, uint32_t vertex_count) {
+	std::vector< uint32_t > order;
+	order.reserve(vertex_count);
+	std::vector< uint32_t > renumbered(vertex_count, -1U);
+	for (uint32_t &v : indices) {
+		assert(v < vertex_count);
+		if (renumbered[v] == -1U) {
+			renumbered[v] = uint32_t(order.size());
+			order.emplace_back(v);
+		}
+		v = renumbered[v];
+	}
+	for (uint32_t v = 0; v < vertex_count; ++v) {
+		if (renumbered[v] == -1U) order.emplace_back(v);
+	}
+	return order;
+}
+
+std::vector< uint32_t > optimize_triangles(std::vector< uint32_t > &indices, std::vector< glm::vec3 > const &positions) {
+	if (indices.size() % 3 != 0) {
+		throw std::runtime_error("optimize_triangles expects a triangle list.");
+	}
+	uint32_t vertex_count = uint32_t(positions.size());
+	std::vector< uint32_t > clusters = optimize_vertex_cache(indices, vertex_count);
+	optimize_overdraw(indices, positions, clusters);
+	return order_vertices_by_first_use(indices, vertex_count);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+//Reordering of indexed triangle lists, so they draw faster without changing what is drawn:
+//
+//  std::vector< uint32_t > order = optimize_triangles(indices, positions); //(MeshBuffer does this when welding)
+//
+// Triangles are first put in an order that reuses the GPU's post-transform vertex cache
+// ("Tipsify", Sander, Nehab, and Barczak 2007), then runs of that order are sorted so
+// outward-facing parts of the mesh come first (reducing overdraw), and finally vertices
+// are renumbered in the order they are first used (so vertex fetches are nearly sequential).
+//
+// Indices are zero-based and refer to 'positions' (one per vertex).
+
+//FIFO cache size used for optimizing and measuring (about that of current GPUs):
+constexpr uint32_t VertexCacheSize = 16;
+
+//how well a triangle list uses a FIFO vertex cache:
+struct VertexCacheStats {
+	float acmr = 0.0f; //average cache miss ratio: vertices transformed per triangle (0.5 at best, 3 at worst)
+	float atvr = 0.0f; //average transform to vertex ratio: vertices transformed per vertex used (1 at best)
+};
+VertexCacheStats vertex_cache_stats(std::vector< uint32_t > const &indices, uint32_t vertex_count, uint32_t cache_size = VertexCacheSize);
+
+//reorder triangles for the vertex cache:
+// returns the (triangle) indices at which "hard" clusters start -- places where the order had to jump
+// to an unrelated part of the mesh -- for use by optimize_overdraw.
+std::vector< uint32_t > optimize_vertex_cache(std::vector< uint32_t > &indices, uint32_t vertex_count, uint32_t cache_size = VertexCacheSize);
+
+//reorder clusters of triangles (as returned by optimize_vertex_cache) so that outward-facing ones are drawn first:
+// clusters are split further wherever that costs at most 'threshold' times their ACMR.
+void optimize_overdraw(std::vector< uint32_t > &indices, std::vector< glm::vec3 > const &positions, std::vector< uint32_t > const &clusters, float threshold = 1.05f, uint32_t cache_size = VertexCacheSize);
+
+//renumber vertices in order of first use (unused vertices go last):
+// returns the old index of each new vertex.
+std::vector< uint32_t > order_vertices_by_first_use(std::vector< uint32_t > &indices, uint32_t vertex_count);
+
+//all of the above:
+// returns the old index of each new vertex (as order_vertices_by_first_use).
+std::vector< uint32_t > optimize_triangles(std::vector< uint32_t > &indices, std::vector< glm::vec3 > const &positions);
@@ -0,0 +1,52 @@
+#pragma once
+
+//Helpers for the quantized vertex formats (see MeshBuffer.hpp and meshes/quantize-meshes.py):
+// positions are four 16-bit unsigned normalized values (w is always 1) relative to a box,
+// normals are GL_INT_2_10_10_10_REV signed normalized values (w is unused).
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+struct QuantizedPosition {
+	uint16_t x, y, z, w;
+};
+static_assert(sizeof(QuantizedPosition) == 8, "QuantizedPosition is packed.");
+
+//position -> [0,1]^3 within the box (offset, offset + scale) -> 16 bits per axis:
+inline QuantizedPosition quantize_position(glm::vec3 const &position, glm::vec3 const &offset, glm::vec3 const &scale) {
+	QuantizedPosition ret;
+	uint16_t *out[3] = {&ret.x, &ret.y, &ret.z};
+	for (uint32_t a = 0; a < 3; ++a) {
+		float t = (scale[a] != 0.0f ? (position[a] - offset[a]) / scale[a] : 0.0f);
+		*out[a] = uint16_t(std::round(std::max(0.0f, std::min(1.0f, t)) * 65535.0f));
+	}
+	ret.w = 0xffff;
+	return ret;
+}
+
+inline glm::vec3 dequantize_position(QuantizedPosition const &q, glm::vec3 const &offset, glm::vec3 const &scale) {
+	return offset + scale * glm::vec3(q.x / 65535.0f, q.y / 65535.0f, q.z / 65535.0f);
+}
+
+//(unit) normal -> 10 signed bits per axis, x in the low bits:
+inline uint32_t quantize_normal(glm::vec3 const &normal) {
+	uint32_t ret = 0;
+	for (uint32_t a = 0; a < 3; ++a) {
+		int32_t v = int32_t(std::round(std::max(-1.0f, std::min(1.0f, normal[a])) * 511.0f));
+		ret |= (uint32_t(v) & 0x3ff) << (10 * a);
+	}
+	return ret;
+}
+
+inline glm::vec3 dequantize_normal(uint32_t q) {
+	glm::vec3 ret;
+	for (uint32_t a = 0; a < 3; ++a) {
+		int32_t v = int32_t((q >> (10 * a)) & 0x3ff);
+		if (v >= 512) v -= 1024; //(sign extend)
+		ret[a] = std::max(-1.0f, v / 511.0f);
+	}
+	return ret;
+}
@@ -4,6 +4,9 @@
 #include <vector>
 #include <stdexcept>
 #include <cassert>
+#include <cstring>
+#include <cstdint>
+#include <string>
 
 template< typename T >
 void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *_to) {
@@ -33,3 +36,53 @@ void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *
 		throw std::runtime_error("Failed to read chunk data.");
 	}
 }
+
+//The same chunk format, read from a block of memory (e.g., a MappedFile) starting at 'at' and ending before 'end':
+// each of these advances 'at' past the chunk.
+
+//find a chunk's data in place (without copying it):
+// returns a pointer to the data and sets '*_size' to its length in bytes.
+inline uint8_t const *read_chunk_in_place(uint8_t const *&at, uint8_t const *end, std::string const &magic, size_t *_size) {
+	assert(_size);
+
+	struct ChunkHeader {
+		char magic[4] = {'\0', '\0', '\0', '\0'};
+		uint32_t size = 0;
+	};
+	static_assert(sizeof(ChunkHeader) == 8, "header is packed");
+
+	ChunkHeader header;
+	if (size_t(end - at) < sizeof(header)) {
+		throw std::runtime_error("Failed to read chunk header");
+	}
+	std::memcpy(&header, at, sizeof(header));
+	if (std::string(header.magic,4) != magic) {
+		throw std::runtime_error("Unexpected magic number in chunk (expected '" + magic + "', got '" + std::string(header.magic, header.magic + 4) + "')");
+	}
+	if (size_t(end - at) - sizeof(header) < header.size) {
+		throw std::runtime_error("Failed to read chunk data.");
+	}
+
+	uint8_t const *data = at + sizeof(header);
+	at = data + header.size;
+	*_size = header.size;
+	return data;
+}
+
+//copy a chunk into a vector of structures:
+// (chunks aren't padded, so for most element types the copy is needed for alignment)
+template< typename T >
+void read_chunk(uint8_t const *&at, uint8_t const *end, std::string const &magic, std::vector< T > *_to) {
+	assert(_to);
+	auto &to = *_to;
+
+	size_t size = 0;
+	uint8_t const *data = read_chunk_in_place(at, end, magic, &size);
+
+	if (size % sizeof(T) != 0) {
+		throw std::runtime_error("Size of chunk not divisible by element size");
+	}
+
+	to.resize(size / sizeof(T));
+	if (size) std::memcpy(&to[0], data, size);
+}
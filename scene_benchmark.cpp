@@ -0,0 +1,155 @@
+//Microbenchmarks for Scene's transform hierarchy.
+// run from the 'dist' directory (uses data_path to find scene files):
+//   ./scene-benchmark
+
+#include "Scene.hpp"
+#include "FlatHierarchy.hpp"
+#include "data_path.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+//returns average time (in microseconds) per call of 'fn':
+template< typename F >
+double time_per_iteration(uint32_t iterations, F const &fn) {
+	fn(); //warm up
+	auto before = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < iterations; ++i) {
+		fn();
+	}
+	auto after = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration< double, std::micro >(after - before).count() / iterations;
+}
+
+//compare cached and uncached world matrix queries for every transform in a scene:
+void benchmark_world_matrices(std::string const &label, Scene &scene, Scene::Transform *root, uint32_t iterations) {
+	std::vector< Scene::Transform * > transforms;
+	for (Scene::Transform &t : scene.transforms) {
+		transforms.emplace_back(&t);
+	}
+
+	//the sum keeps the compiler from discarding the matrix computations:
+	float sum = 0.0f;
+
+	double uncached = time_per_iteration(iterations, [&](){
+		for (auto t : transforms) {
+			sum += t->make_local_to_world()[3].x;
+		}
+	});
+
+	double cached_static = time_per_iteration(iterations, [&](){
+		for (auto t : transforms) {
+			sum += t->get_local_to_world()[3].x;
+		}
+	});
+
+	//worst case: root moves every frame, so every cached matrix is recomputed (once):
+	double cached_moving = time_per_iteration(iterations, [&](){
+		root->set_position(root->position + glm::vec3(0.0f, 0.0f, 1e-6f));
+		for (auto t : transforms) {
+			sum += t->get_local_to_world()[3].x;
+		}
+	});
+
+	std::cout << label << " (" << transforms.size() << " transforms):\n";
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "  uncached make_local_to_world: " << uncached << " us/frame\n";
+	std::cout << "  cached, nothing moving:       " << cached_static << " us/frame\n";
+	std::cout << "  cached, root moving:          " << cached_moving << " us/frame\n";
+
+	//flattened structure-of-arrays update of every world matrix:
+	FlatHierarchy flat;
+	flat.build(scene);
+	double flat_update = time_per_iteration(iterations, [&](){
+		flat.update();
+		sum += flat.local_to_world.back()[3].x;
+	});
+	double flat_round_trip = time_per_iteration(iterations, [&](){
+		flat.pull();
+		flat.update();
+		flat.push();
+		sum += flat.local_to_world.back()[3].x;
+	});
+
+	//check that the flat update agrees with the pointer-based one:
+	float max_error = 0.0f;
+	for (uint32_t i = 0; i < flat.size(); ++i) {
+		glm::mat4 expected = flat.transforms[i]->make_local_to_world();
+		for (uint32_t c = 0; c < 4; ++c) {
+			for (uint32_t r = 0; r < 4; ++r) {
+				max_error = std::max(max_error, std::abs(flat.local_to_world[i][c][r] - expected[c][r]));
+			}
+		}
+	}
+
+	std::cout << "  FlatHierarchy update:         " << flat_update << " us/frame\n";
+	std::cout << "  FlatHierarchy pull+update+push: " << flat_round_trip << " us/frame\n";
+	std::cout << "  (max error vs. make_local_to_world " << std::scientific << max_error << std::fixed << ")\n";
+	std::cout << "  (checksum " << sum << ")" << std::endl;
+}
+
+//time the flattened update pass on a large synthetic hierarchy:
+void benchmark_flat_update(uint32_t count, uint32_t iterations) {
+	FlatHierarchy flat;
+	//a wide, shallow tree (each entry's parent is entry / 8), as in a big level full of props:
+	for (uint32_t i = 0; i < count; ++i) {
+		flat.add(
+			(i == 0 ? -1U : (i - 1) / 8),
+			glm::vec3(0.1f * (i % 7), 0.2f * (i % 5), 0.3f * (i % 3)),
+			glm::angleAxis(0.001f * i, glm::normalize(glm::vec3(1.0f, 2.0f, 3.0f))),
+			glm::vec3(1.0f)
+		);
+	}
+	float sum = 0.0f;
+	double elapsed = time_per_iteration(iterations, [&](){
+		flat.update();
+		sum += flat.local_to_world.back()[3].x;
+	});
+	std::cout << "FlatHierarchy update of " << count << " entries: " << std::fixed << std::setprecision(2) << elapsed << " us/frame\n";
+	std::cout << "  (checksum " << sum << ")" << std::endl;
+}
+
+int main(int argc, char **argv) {
+	{ //the hierarchy from phone-bank.scene, re-parented under a single root:
+		Scene scene;
+		scene.load(data_path("phone-bank.scene"));
+		Scene::Transform *root = scene.new_transform();
+		for (Scene::Transform &t : scene.transforms) {
+			if (&t != root && t.parent == nullptr) t.set_parent(root);
+		}
+		benchmark_world_matrices("phone-bank.scene", scene, root, 10000);
+	}
+
+	{ //synthetic deep tree: 16 chains of depth 256, with two leaves hanging off every chain link:
+		Scene scene;
+		Scene::Transform *root = scene.new_transform();
+		for (uint32_t chain = 0; chain < 16; ++chain) {
+			Scene::Transform *at = root;
+			for (uint32_t depth = 0; depth < 256; ++depth) {
+				Scene::Transform *link = scene.new_transform();
+				link->set_parent(at);
+				link->set_position(glm::vec3(0.0f, 0.0f, 0.1f));
+				link->set_rotation(glm::angleAxis(0.01f * chain, glm::vec3(0.0f, 0.0f, 1.0f)));
+				for (uint32_t leaf = 0; leaf < 2; ++leaf) {
+					Scene::Transform *t = scene.new_transform();
+					t->set_parent(link);
+					t->set_position(glm::vec3(leaf ? 1.0f : -1.0f, 0.0f, 0.0f));
+				}
+				at = link;
+			}
+		}
+		benchmark_world_matrices("synthetic deep tree", scene, root, 10);
+	}
+
+	benchmark_flat_update(100000, 100);
+
+	return 0;
+}
@@ -0,0 +1,148 @@
+//Reports how well each mesh's triangles use the post-transform vertex cache,
+// in export order and after each step of optimize_triangles (as MeshBuffer applies when welding).
+// run from the 'dist' directory (uses data_path to find mesh files):
+//   ./vertex-cache-report [file.pnc ...]
+
+#include "optimize_triangles.hpp"
+#include "read_chunk.hpp"
+#include "data_path.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+//one mesh's welded triangles, as MeshBuffer would make them:
+struct WeldedMesh {
+	std::vector< glm::vec3 > positions;
+	std::vector< uint32_t > indices;
+};
+
+std::map< std::string, WeldedMesh > load_welded(std::string const &filename) {
+	//(float formats only; the quantized formats have the same triangles as the files they were made from)
+	struct Format {
+		char const *extension;
+		char const *magic;
+		uint32_t stride;
+	};
+	static Format const formats[] = {
+		{".p", "p...", 3*4},
+		{".pn", "pn..", 3*4+3*4},
+		{".pnc", "pnc.", 3*4+3*4+4*1},
+		{".pnct", "pnct", 3*4+3*4+4*1+2*4},
+	};
+	Format const *format = nullptr;
+	for (Format const &f : formats) {
+		size_t len = std::strlen(f.extension);
+		if (filename.size() >= len && filename.substr(filename.size() - len) == f.extension) format = &f;
+	}
+	if (!format) {
+		throw std::runtime_error("Unknown file type '" + filename + "'");
+	}
+
+	std::ifstream file(filename, std::ios::binary);
+	std::vector< uint8_t > vertices;
+	read_chunk(file, format->magic, &vertices);
+	std::vector< char > strings;
+	read_chunk(file, "str0", &strings);
+	struct IndexEntry {
+		uint32_t name_begin, name_end;
+		uint32_t vertex_begin, vertex_end;
+	};
+	static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
+	std::vector< IndexEntry > index;
+	read_chunk(file, "idx0", &index);
+
+	uint32_t stride = format->stride;
+	if (vertices.size() % stride != 0) {
+		throw std::runtime_error("Size of vertex chunk in '" + filename + "' not divisible by vertex size.");
+	}
+	std::map< std::string, WeldedMesh > ret;
+	for (IndexEntry const &entry : index) {
+		if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
+			throw std::runtime_error("index entry has out-of-range name begin/end");
+		}
+		if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= vertices.size() / stride)) {
+			throw std::runtime_error("index entry has out-of-range vertex start/count");
+		}
+		WeldedMesh &mesh = ret[std::string(&strings[0] + entry.name_begin, &strings[0] + entry.name_end)];
+		//merge byte-identical vertices:
+		std::map< std::vector< uint8_t >, uint32_t > seen;
+		for (uint32_t i = entry.vertex_begin; i < entry.vertex_end; ++i) {
+			std::vector< uint8_t > bytes(vertices.begin() + size_t(i) * stride, vertices.begin() + size_t(i + 1) * stride);
+			auto f = seen.insert(std::make_pair(bytes, uint32_t(mesh.positions.size())));
+			if (f.second) {
+				glm::vec3 position;
+				std::memcpy(&position, bytes.data(), sizeof(position));
+				mesh.positions.emplace_back(position);
+			}
+			mesh.indices.emplace_back(f.first->second);
+		}
+	}
+	return ret;
+}
+
+int main(int argc, char **argv) {
+	std::vector< std::string > filenames;
+	for (int i = 1; i < argc; ++i) {
+		filenames.emplace_back(argv[i]);
+	}
+	if (filenames.empty()) {
+		filenames = { data_path("phone-bank.pnc"), data_path("crates.pnc"), data_path("meshes.pnc") };
+	}
+
+	std::cout << "FIFO cache of " << VertexCacheSize << " vertices; ACMR (vertices transformed per triangle) / ATVR (per vertex):\n";
+	for (std::string const &filename : filenames) {
+		std::map< std::string, WeldedMesh > meshes = load_welded(filename);
+
+		std::cout << "\n" << filename << "\n";
+		std::cout << "  " << std::left << std::setw(28) << "mesh" << std::right
+			<< std::setw(8) << "tris" << std::setw(8) << "verts"
+			<< std::setw(16) << "export" << std::setw(16) << "vertex cache" << std::setw(16) << "+ overdraw" << "\n";
+
+		//totals, weighted by triangles (ACMR) and vertices (ATVR):
+		uint32_t total_triangles = 0, total_vertices = 0;
+		VertexCacheStats total[3];
+
+		std::cout << std::fixed << std::setprecision(3);
+		for (auto &name_mesh : meshes) {
+			WeldedMesh &mesh = name_mesh.second;
+			if (mesh.indices.empty() || mesh.indices.size() % 3 != 0) continue;
+			uint32_t vertex_count = uint32_t(mesh.positions.size());
+			uint32_t triangle_count = uint32_t(mesh.indices.size() / 3);
+
+			VertexCacheStats stats[3];
+			stats[0] = vertex_cache_stats(mesh.indices, vertex_count);
+			std::vector< uint32_t > clusters = optimize_vertex_cache(mesh.indices, vertex_count);
+			stats[1] = vertex_cache_stats(mesh.indices, vertex_count);
+			optimize_overdraw(mesh.indices, mesh.positions, clusters);
+			stats[2] = vertex_cache_stats(mesh.indices, vertex_count);
+
+			std::cout << "  " << std::left << std::setw(28) << name_mesh.first << std::right
+				<< std::setw(8) << triangle_count << std::setw(8) << vertex_count;
+			for (uint32_t s = 0; s < 3; ++s) {
+				std::cout << std::setw(9) << stats[s].acmr << " /" << std::setw(5) << std::setprecision(2) << stats[s].atvr << std::setprecision(3);
+				total[s].acmr += stats[s].acmr * triangle_count;
+				total[s].atvr += stats[s].atvr * vertex_count;
+			}
+			std::cout << "\n";
+			total_triangles += triangle_count;
+			total_vertices += vertex_count;
+		}
+		if (total_triangles == 0) continue;
+		std::cout << "  " << std::left << std::setw(28) << "(all)" << std::right
+			<< std::setw(8) << total_triangles << std::setw(8) << total_vertices;
+		for (uint32_t s = 0; s < 3; ++s) {
+			std::cout << std::setw(9) << total[s].acmr / total_triangles << " /" << std::setw(5) << std::setprecision(2) << total[s].atvr / total_vertices << std::setprecision(3);
+		}
+		std::cout << "\n";
+	}
+	std::cout.flush();
+
+	return 0;
+}
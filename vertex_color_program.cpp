@@ -1,22 +1,47 @@
 #include "vertex_color_program.hpp"
 
 #include "compile_program.hpp"
+#include "Scene.hpp"
 
-VertexColorProgram::VertexColorProgram() {
+#include <string>
+
+VertexColorProgram::VertexColorProgram(bool instanced) {
 	program = compile_program(
 		"#version 330\n"
-		"uniform mat4 object_to_clip;\n"
-		"uniform mat4x3 object_to_light;\n"
-		"uniform mat3 normal_to_light;\n"
+		"uniform mat4 world_to_clip;\n"
+		+ std::string(instanced ?
+			"uniform samplerBuffer instance_data;\n"
+			"uniform int instance_base;\n"
+		:
+			"layout(std140) uniform ObjectBlock {\n" //(see Scene::ObjectBlock)
+			"	mat4x3 object_to_light;\n"
+			"	mat3 normal_to_light;\n"
+			"};\n"
+		) +
 		"layout(location=0) in vec4 Position;\n" //note: layout keyword used to make sure that the location-0 attribute is always bound to something
 		"in vec3 Normal;\n"
 		"in vec4 Color;\n"
 		"out vec3 position;\n"
 		"out vec3 normal;\n"
 		"out vec4 color;\n"
+		"invariant gl_Position;\n" //(so depth matches depth_program's pre-pass exactly)
 		"void main() {\n"
-		"	gl_Position = object_to_clip * Position;\n"
+		+ (instanced ?
+			"	int at = 6 * (instance_base + gl_InstanceID);\n"
+			"	mat4x3 object_to_light = transpose(mat3x4(\n"
+			"		texelFetch(instance_data, at+0),\n"
+			"		texelFetch(instance_data, at+1),\n"
+			"		texelFetch(instance_data, at+2)\n"
+			"	));\n"
+			"	mat3 normal_to_light = mat3(\n"
+			"		texelFetch(instance_data, at+3).xyz,\n"
+			"		texelFetch(instance_data, at+4).xyz,\n"
+			"		texelFetch(instance_data, at+5).xyz\n"
+			"	);\n"
+		: ""
+		) +
 		"	position = object_to_light * Position;\n"
+		"	gl_Position = world_to_clip * vec4(position, 1.0);\n"
 		"	normal = normal_to_light * Normal;\n"
 		"	color = Color;\n"
 		"}\n"
@@ -47,16 +72,28 @@ VertexColorProgram::VertexColorProgram() {
 		"}\n"
 	);
 
-	object_to_clip_mat4 = glGetUniformLocation(program, "object_to_clip");
-	object_to_light_mat4x3 = glGetUniformLocation(program, "object_to_light");
-	normal_to_light_mat3 = glGetUniformLocation(program, "normal_to_light");
-
 	sun_direction_vec3 = glGetUniformLocation(program, "sun_direction");
 	sun_color_vec3 = glGetUniformLocation(program, "sun_color");
 	sky_direction_vec3 = glGetUniformLocation(program, "sky_direction");
 	sky_color_vec3 = glGetUniformLocation(program, "sky_color");
+
+	world_to_clip_mat4 = glGetUniformLocation(program, "world_to_clip");
+
+	object_block_index = glGetUniformBlockIndex(program, "ObjectBlock");
+	if (object_block_index != GL_INVALID_INDEX) {
+		glUniformBlockBinding(program, object_block_index, Scene::ObjectBlockBinding);
+	} else {
+		object_block_index = -1U;
+	}
+
+	instance_data_samplerBuffer = glGetUniformLocation(program, "instance_data");
+	instance_base_int = glGetUniformLocation(program, "instance_base");
 }
 
 Load< VertexColorProgram > vertex_color_program(LoadTagInit, [](){
 	return new VertexColorProgram();
 });
+
+Load< VertexColorProgram > vertex_color_program_instanced(LoadTagInit, [](){
+	return new VertexColorProgram(true);
+});
@@ -6,15 +6,28 @@ struct VertexColorProgram {
 	GLuint program = 0;
 
 	//uniform locations:
-	GLuint object_to_clip_mat4 = -1U;
-	GLuint object_to_light_mat4x3 = -1U;
-	GLuint normal_to_light_mat3 = -1U;
+	GLuint world_to_clip_mat4 = -1U;
 	GLuint sun_direction_vec3 = -1U;
 	GLuint sun_color_vec3 = -1U;
 	GLuint sky_direction_vec3 = -1U;
 	GLuint sky_color_vec3 = -1U;
 
-	VertexColorProgram();
+	//uniform block used only by the regular variant:
+	// per-object matrices are read from a uniform buffer range (see Scene::ObjectBlock)
+	GLuint object_block_index = -1U;
+
+	//uniform locations used only by the instanced variant:
+	// per-instance matrices are read from a buffer texture
+	GLuint instance_data_samplerBuffer = -1U;
+	GLuint instance_base_int = -1U;
+
+	VertexColorProgram(bool instanced = false);
 };
 
 extern Load< VertexColorProgram > vertex_color_program;
+
+//instanced variant: draws many copies of a mesh with glDrawArraysInstanced.
+// Instance (instance_base + gl_InstanceID) reads six texels from instance_data:
+//  texels 0-2: rows of the object-to-light (i.e., object-to-world) matrix
+//  texels 3-5: columns of the normal-to-light matrix (in .xyz)
+extern Load< VertexColorProgram > vertex_color_program_instanced;